@@ -0,0 +1,57 @@
+/******************************************************************************
+File name: FrameBudget.h
+Description: Token bucket limiting the rate frames are started on a serial
+    link, so the link is never offered more than it can carry and commands
+    queue in the mailbox (where they are coalesced) instead of in the
+    driver.
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_FRAME_BUDGET_H
+#define MMUAV_ARDUCOPTER_BRIDGE_FRAME_BUDGET_H
+
+#include <algorithm>
+
+class FrameBudget
+{
+public:
+    FrameBudget() : rate(0.0), burst(1.0), tokens(1.0), lastUpdate(0.0) {}
+
+    // rate     frames per second, 0 disables the budget
+    // burst    frames that can be sent back to back after an idle period
+    void Configure(double rate, double burst)
+    {
+        this->rate = rate;
+        this->burst = std::max(burst, 1.0);
+        tokens = this->burst;
+    }
+
+    void Reset(double now)
+    {
+        tokens = burst;
+        lastUpdate = now;
+    }
+
+    double GetRate() const { return rate; }
+
+    // Returns true if a frame may be started at now, otherwise wait is set
+    // to the time [s] until it may.
+    bool Ready(double now, double &wait)
+    {
+        if (rate <= 0.0) return true;
+        tokens = std::min(burst, tokens + (now - lastUpdate)*rate);
+        lastUpdate = now;
+        if (tokens >= 1.0) return true;
+        wait = (1.0 - tokens)/rate;
+        return false;
+    }
+
+    // A frame was started
+    void Consume()
+    {
+        if (rate > 0.0) tokens -= 1.0;
+    }
+
+private:
+    double rate, burst, tokens, lastUpdate;
+};
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_FRAME_BUDGET_H
@@ -7,24 +7,25 @@ Author: Antun Ivanovic
 
 #include <iostream>
 #include <vector>
-#include <math.h>
-#include <ros/package.h>
 #include <string>
-#include <fstream>
-#include <iostream>
-#include <stdlib.h>
-#include <sstream>
-#include <termios.h>
 #include <unistd.h>
 #include <errno.h>
-#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 
-#include <std_msgs/Float64MultiArray.h>
-#include <mmuav_arducopter_bridge/StepperParametersConfig.h>
-#include <dynamic_reconfigure/server.h>
+#include <StepperPort.h>
 
 using namespace std;
 
+// Serves one or more stepper boards from a single I/O thread. With the
+// ~ports list every board has its own parameter namespace (~<name>/port,
+// ~<name>/baudrate, ~<name>/protocol...) and topic namespace
+// (~<name>/namespace, defaults to <name>). Without it a single board is
+// configured from ~port, ~baudrate... and uses the node's namespace.
 class GazeboToArducopterSerial
 {
 public:
@@ -33,22 +34,18 @@ public:
     void run();
 
 private:
-    // Open and configure serial port.
-    struct termios tty;
-    struct termios tty_old;
-    int USB;
-    int SetSerialAttributes(string port, int baudrate);
-    int baudrate; string port;
-    int SerialWrite(int m[4], unsigned char terminator);
-    int SerialRead();
+    std::vector<boost::shared_ptr<StepperPort> > ports;
+
+    // I/O thread, waits on all ttys and on wakeFd with one epoll set
+    boost::thread ioThread;
+    int epollFd, wakeFd;
+    std::atomic<bool> ioRunning;
+    bool StartIoThread();
+    void StopIoThread();
+    void IoLoop();
+    void Wake();
 
     // ROS-related
     // Node handles
     ros::NodeHandle nhParams, nhTopics;
-    ros::Subscriber all_mass_sub;
-    void allMassCallback(const std_msgs::Float64MultiArray &msg);
-    dynamic_reconfigure::Server<mmuav_arducopter_bridge::StepperParametersConfig> server;
-    dynamic_reconfigure::Server<mmuav_arducopter_bridge::StepperParametersConfig>::CallbackType f;
-    void reconfigureCallback(mmuav_arducopter_bridge::StepperParametersConfig &config, uint32_t level);
-
-};
\ No newline at end of file
+};
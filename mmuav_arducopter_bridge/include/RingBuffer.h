@@ -0,0 +1,74 @@
+/******************************************************************************
+File name: RingBuffer.h
+Description: Byte ring buffer for serial I/O. Exposes contiguous spans so
+    read()/write() go straight to and from the buffer without copies.
+    Single producer, single consumer, not thread safe.
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_RING_BUFFER_H
+#define MMUAV_ARDUCOPTER_BRIDGE_RING_BUFFER_H
+
+#include <vector>
+#include <stddef.h>
+
+class RingBuffer
+{
+public:
+    // Capacity is rounded up to a power of two
+    explicit RingBuffer(size_t capacity = 4096)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        data.resize(size);
+        mask = size - 1;
+        head = 0;
+        tail = 0;
+    }
+
+    size_t Capacity() const { return data.size(); }
+    size_t Size() const { return head - tail; }
+    size_t Free() const { return data.size() - Size(); }
+    bool Empty() const { return head == tail; }
+    void Clear() { head = tail = 0; }
+
+    // Byte at offset from the oldest byte, offset < Size()
+    unsigned char Peek(size_t offset) const
+    {
+        return data[(tail + offset) & mask];
+    }
+    // Stores a byte at offset past the newest byte, offset < Free(). Bytes
+    // become readable after Commit().
+    void Poke(size_t offset, unsigned char value)
+    {
+        data[(head + offset) & mask] = value;
+    }
+
+    // Contiguous readable region starting at the oldest byte
+    size_t ReadableSpan(const unsigned char **span) const
+    {
+        size_t start = tail & mask;
+        size_t length = data.size() - start;
+        if (length > Size()) length = Size();
+        *span = &data[start];
+        return length;
+    }
+    // Contiguous free region after the newest byte
+    size_t WritableSpan(unsigned char **span)
+    {
+        size_t start = head & mask;
+        size_t length = data.size() - start;
+        if (length > Free()) length = Free();
+        *span = &data[start];
+        return length;
+    }
+
+    void Commit(size_t length) { head += length; }
+    void Consume(size_t length) { tail += length; }
+
+private:
+    std::vector<unsigned char> data;
+    size_t mask;
+    // Free running indices, wrap around is handled by the mask
+    size_t head, tail;
+};
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_RING_BUFFER_H
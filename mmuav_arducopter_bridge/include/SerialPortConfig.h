@@ -0,0 +1,20 @@
+/******************************************************************************
+File name: SerialPortConfig.h
+Description: Linux specific serial port settings that are not reachable
+    through termios.h. Kept in a separate translation unit because the
+    kernel termios2 headers clash with the libc ones.
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_SERIAL_PORT_CONFIG_H
+#define MMUAV_ARDUCOPTER_BRIDGE_SERIAL_PORT_CONFIG_H
+
+// Sets input and output speed to any baudrate the driver can generate
+// (termios2, BOTHER). The speed the driver actually set is stored in
+// actual. Returns false on failure, errno is set.
+bool SetArbitraryBaudrate(int fd, int baudrate, int &actual);
+
+// Sets or clears ASYNC_LOW_LATENCY, the driver then pushes received bytes
+// to the tty immediately instead of batching them. Returns false if the
+// driver doesn't support it (e.g. ptys, some USB adapters).
+bool SetLowLatency(int fd, bool enable);
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_SERIAL_PORT_CONFIG_H
@@ -0,0 +1,54 @@
+/******************************************************************************
+File name: SerialTransport.h
+Description: Stand-alone, ROS-free transport to one stepper board. Owns a
+    StepperLink and the I/O thread servicing it, so it can be linked into
+    any process, e.g. a Gazebo plugin driving the board in the loop.
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_SERIAL_TRANSPORT_H
+#define MMUAV_ARDUCOPTER_BRIDGE_SERIAL_TRANSPORT_H
+
+#include <string>
+#include <atomic>
+#include <boost/thread.hpp>
+
+#include <StepperLink.h>
+
+class SerialTransport
+{
+public:
+    typedef StepperLink::Frame Frame;
+    typedef StepperLink::Settings Settings;
+    typedef StepperLink::FrameCallback FrameCallback;
+
+    SerialTransport();
+    ~SerialTransport();
+
+    // Set before Open(), frames are delivered from the I/O thread
+    void SetFrameCallback(const FrameCallback &callback);
+    // Opens the tty and starts the I/O thread. On failure error describes
+    // why.
+    bool Open(const Settings &settings, std::string &error);
+    void Close();
+    // False once the device hung up
+    bool IsOpen() const { return ioRunning; }
+
+    // Thread safe. Motion commands replace the one not yet sent, values
+    // are in steps.
+    void SendCommand(const int32_t values[StepperProtocol::VALUES]);
+    void SendParameters(const int32_t values[StepperProtocol::VALUES]);
+
+    // Snapshot of the link counters, refreshed by the I/O thread
+    void GetCounters(StepperLink::Counters &counters);
+
+private:
+    StepperLink link;
+    boost::thread ioThread;
+    int epollFd, wakeFd;
+    std::atomic<bool> ioRunning;
+    boost::mutex countersMutex;
+    StepperLink::Counters counters;
+    void IoLoop();
+    void Wake();
+};
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_SERIAL_TRANSPORT_H
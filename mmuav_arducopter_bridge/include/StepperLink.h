@@ -0,0 +1,167 @@
+/******************************************************************************
+File name: StepperLink.h
+Description: ROS-free serial link to one stepper board: tty setup, command
+    mailbox, frame budget, framing and feedback parsing. The link does no
+    I/O on its own, it is serviced by an epoll loop (GazeboToArducopterSerial
+    for the ROS bridge, SerialTransport for everything else).
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_STEPPER_LINK_H
+#define MMUAV_ARDUCOPTER_BRIDGE_STEPPER_LINK_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <stdint.h>
+#include <termios.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <RingBuffer.h>
+#include <FrameBudget.h>
+#include <StepperProtocol.h>
+
+class StepperLink
+{
+public:
+    typedef StepperProtocol::Frame Frame;
+    // Called from the I/O thread for every valid frame from the board,
+    // receivedTime is on the monotonic clock.
+    typedef boost::function<void(const Frame &frame, double receivedTime)>
+        FrameCallback;
+
+    struct Settings
+    {
+        std::string port;
+        int baudrate;
+        int protocol;               // StepperProtocol::LEGACY or FRAMED
+        bool lowLatency;            // request ASYNC_LOW_LATENCY
+        int maxOutputQueue;         // driver queue gate [bytes], 0 - one frame
+        double linkBudget;          // share of the link used for frames
+        double maxCommandRate;      // frame rate cap [Hz], 0 - none
+        double parameterMaxDelay;   // longest wait of parameters [s]
+        bool useTcdrain;            // exact wire time, blocks the I/O thread
+
+        Settings() : port("/dev/ttyUSB0"), baudrate(115200),
+            protocol(StepperProtocol::LEGACY), lowLatency(true),
+            maxOutputQueue(0), linkBudget(0.8), maxCommandRate(0.0),
+            parameterMaxDelay(0.1), useTcdrain(false) {}
+    };
+
+    // Counters since the link was opened
+    struct Counters
+    {
+        unsigned long commandsReceived, motionReplaced;
+        unsigned long parametersReceived, parametersDropped;
+        unsigned long framesWritten, bytesWritten, shortWrites, writeErrors;
+        unsigned long framesRead, bytesRead, readErrors, rxOverflows;
+        unsigned long crcErrors, discardedBytes, lostFeedback, throttled;
+    };
+
+    // Latency samples [s] collected since the last TakeLatencies()
+    struct Latencies
+    {
+        std::vector<double> queue;      // command receipt to frame build
+        std::vector<double> write;      // frame build to write() completion
+        std::vector<double> wire;       // command receipt to on the wire
+        std::vector<double> roundTrip;  // command receipt to board echo
+    };
+
+    StepperLink();
+    ~StepperLink();
+
+    // Opens and configures the tty. On failure error describes why.
+    bool Open(const Settings &settings, std::string &error);
+    void Close();
+    bool IsOpen() const { return USB >= 0; }
+    int GetFd() const { return USB; }
+    const Settings &GetSettings() const { return settings; }
+    int GetActualBaudrate() const { return actualBaudrate; }
+    bool IsLowLatency() const { return lowLatencySet; }
+    double GetFrameBudget() const { return budget.GetRate(); }
+
+    void SetFrameCallback(const FrameCallback &callback);
+
+    // Thread safe, called from any thread. receivedTime is the monotonic
+    // time the command entered the process.
+    void QueueMotion(const int32_t values[StepperProtocol::VALUES],
+        double receivedTime);
+    void QueueParameters(const int32_t values[StepperProtocol::VALUES],
+        double receivedTime);
+
+    // I/O thread side. Attach registers the tty with epoll under data.ptr,
+    // commands wake the loop through wakeFd.
+    void Attach(int epollFd, int wakeFd, void *data);
+    // Starts and writes frames, timeout [ms] is lowered to when the link
+    // next needs servicing.
+    void Service(int &timeout);
+    // Handles epoll events of the tty. Returns false if the device hung up,
+    // the link is closed then.
+    bool HandleEvents(uint32_t events);
+
+    // Counters and latencies are owned by the I/O thread, call these from
+    // the thread servicing the link.
+    void GetCounters(Counters &counters);
+    void TakeLatencies(Latencies &latencies);
+    unsigned long GetLostFeedback() const { return counters.lostFeedback; }
+
+    static double MonotonicNow();
+
+private:
+    Settings settings;
+    int USB;
+    struct termios tty_old;
+    int actualBaudrate;
+    bool lowLatencySet;
+    StepperProtocol protocol;
+    FrameCallback frameCallback;
+
+    // Frame with the monotonic time its command was received
+    struct QueuedFrame
+    {
+        Frame frame;
+        double receivedTime;
+    };
+
+    // Commands from ROS callbacks are handed to the I/O thread. Motion
+    // commands go through a single slot mailbox, a newer command replaces
+    // the one not yet sent. Parameter frames go through a short FIFO.
+    static const size_t PARAMETER_QUEUE_LENGTH = 8;
+    boost::mutex mailboxMutex;
+    bool motionPending;
+    QueuedFrame motionFrame;
+    std::deque<QueuedFrame> parameterQueue;
+    bool HasPendingFrame();
+    bool TakeNextFrame(QueuedFrame &frame, double now);
+
+    // Frames are started at most at the budgeted rate, derived from the
+    // baudrate. Motion has priority over parameters.
+    FrameBudget budget;
+
+    int epollFd, wakeFd;
+    void *epollData;
+    bool waitingWritable;
+    int maxOutputQueue;
+    // Holds at most one encoded frame, empty when the previous one is out
+    RingBuffer txRing;
+    unsigned char txSequence;
+    QueuedFrame txFrame;
+    double txBuildTime;
+    // Feedback from the board, filled by bulk reads and parsed in place
+    RingBuffer rxRing;
+    int lastFeedbackSequence;
+    // Receipt time of sent commands by sequence number, for echo matching
+    double commandReceivedTime[256];
+    bool commandAwaitingEcho[256];
+
+    Counters counters;
+    Latencies latencies;
+
+    void Wake();
+    void SetWritableInterest(bool enable);
+    int WritePending();
+    int ReadAvailable();
+    void HandleFrame(const Frame &frame);
+    void RecordWrite(double now);
+};
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_STEPPER_LINK_H
@@ -0,0 +1,89 @@
+/******************************************************************************
+File name: StepperPort.h
+Description: One stepper board on one serial port. ROS side of a
+    StepperLink: parameters, command and feedback topics, dynamic
+    reconfigure and statistics. The I/O itself is driven by the epoll loop
+    in GazeboToArducopterSerial.
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_STEPPER_PORT_H
+#define MMUAV_ARDUCOPTER_BRIDGE_STEPPER_PORT_H
+
+#include "ros/ros.h"
+
+#include <vector>
+#include <string>
+
+#include <StepperLink.h>
+
+#include <std_msgs/Float64MultiArray.h>
+#include <mmuav_msgs/StepperFeedback.h>
+#include <mmuav_msgs/SerialStatistics.h>
+#include <mmuav_arducopter_bridge/StepperParametersConfig.h>
+#include <dynamic_reconfigure/server.h>
+
+class StepperPort
+{
+public:
+    // Port settings are read from nhParams (~port, ~baudrate, ~protocol...),
+    // topics are advertised in nhTopics. name is only used in log messages.
+    StepperPort(const std::string &name, const ros::NodeHandle &nhParams,
+        const ros::NodeHandle &nhTopics);
+    ~StepperPort();
+
+    const std::string &GetName() const { return name; }
+    // Opens and configures the tty. Returns false if the port can't run
+    // with the requested settings.
+    bool Open();
+    void Close();
+
+    // Registers the tty with the I/O thread's epoll set. Commands wake the
+    // I/O thread through wakeFd.
+    void Attach(int epollFd, int wakeFd);
+    // Starts and writes frames, publishes statistics when due. timeout
+    // [ms] is lowered to when the port next needs servicing.
+    void Service(double now, int &timeout);
+    // Handles epoll events of the tty
+    void HandleEvents(uint32_t events);
+    bool IsOpen() const { return link.IsOpen(); }
+
+    static double MonotonicNow() { return StepperLink::MonotonicNow(); }
+
+private:
+    typedef mmuav_arducopter_bridge::StepperParametersConfig Config;
+    typedef StepperProtocol::Frame Frame;
+
+    std::string name;
+    ros::NodeHandle nhParams, nhTopics;
+
+    // Serial link to the board, ~protocol: 1 legacy 20 byte frames, 2
+    // frames with start bytes, sequence number and CRC
+    StepperLink link;
+    StepperLink::Settings settings;
+    // Stepper positions are sent in steps, mass positions in meters
+    double stepsPerMeter;
+    void HandleFrame(const Frame &frame, double receivedTime);
+
+    // Latency and throughput statistics, published from the I/O thread.
+    // The link timestamps all stages with the monotonic clock.
+    double statisticsPeriod;
+    double openTimeout;
+    double statisticsStart;
+    StepperLink::Counters windowStart;
+    StepperLink::Latencies latencies;
+    mmuav_msgs::SerialStatistics statisticsMsg;
+    void PublishStatistics(double now);
+    static void Percentiles(std::vector<double> &samples,
+        const std::vector<double> &percentiles, std::vector<double> &result);
+
+    // ROS-related
+    ros::Subscriber all_mass_sub;
+    ros::Publisher feedback_pub;
+    ros::Publisher statistics_pub;
+    mmuav_msgs::StepperFeedback feedbackMsg;
+    void allMassCallback(const std_msgs::Float64MultiArray &msg);
+    dynamic_reconfigure::Server<Config> server;
+    dynamic_reconfigure::Server<Config>::CallbackType f;
+    void reconfigureCallback(Config &config, uint32_t level);
+};
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_STEPPER_PORT_H
@@ -0,0 +1,88 @@
+/******************************************************************************
+File name: StepperProtocol.h
+Description: Framing of messages between the bridge and the stepper board.
+    Frames are encoded straight into and decoded straight out of a
+    RingBuffer.
+
+    Protocol 1 (legacy): four little endian int32 values, terminator byte
+    (67 command, 83 parameters) and three zero bytes, 20 bytes total.
+
+    Protocol 2: 0xA5 0x5A, version (2), type (same codes as the legacy
+    terminator), sequence number, payload length, payload, CRC-16/CCITT
+    (little endian) over version..payload.
+
+    Feedback frames from the board (type 70) carry the measured positions
+    followed by status flags and the sequence number of the last command
+    frame the board received. In the legacy protocol the board can't echo
+    sequence numbers and both bytes are zero.
+******************************************************************************/
+#ifndef MMUAV_ARDUCOPTER_BRIDGE_STEPPER_PROTOCOL_H
+#define MMUAV_ARDUCOPTER_BRIDGE_STEPPER_PROTOCOL_H
+
+#include <stdint.h>
+#include <RingBuffer.h>
+
+class StepperProtocol
+{
+public:
+    enum Version
+    {
+        LEGACY = 1,
+        FRAMED = 2
+    };
+
+    enum FrameType
+    {
+        COMMAND = 67,
+        FEEDBACK = 70,
+        PARAMETERS = 83
+    };
+
+    static const int VALUES = 4;
+    static const unsigned char START_BYTE_1 = 0xA5;
+    static const unsigned char START_BYTE_2 = 0x5A;
+    static const size_t LEGACY_FRAME_LENGTH = 20;
+    static const size_t HEADER_LENGTH = 6;
+    static const size_t CRC_LENGTH = 2;
+    static const size_t MAX_PAYLOAD = 64;
+
+    struct Frame
+    {
+        unsigned char type;
+        unsigned char sequence;     // unused in the legacy protocol
+        int32_t values[VALUES];
+        unsigned char status;       // feedback only
+        unsigned char echoedSequence;   // feedback only
+    };
+
+    explicit StepperProtocol(int version = LEGACY);
+
+    int GetVersion() const { return version; }
+    // Encoded length of a frame of the given type
+    size_t FrameLength(unsigned char type = COMMAND) const;
+
+    // Appends the encoded frame to ring. Returns false, leaving ring
+    // untouched, if there is not enough free space.
+    bool Encode(const Frame &frame, RingBuffer &ring) const;
+    // Decodes the first complete frame in ring and consumes it. Bytes that
+    // can't start a valid frame are discarded. Returns false if no complete
+    // frame is available yet.
+    bool Decode(RingBuffer &ring, Frame &frame);
+
+    unsigned long GetCrcErrors() const { return crcErrors; }
+    unsigned long GetDiscardedBytes() const { return discardedBytes; }
+
+    static uint16_t Crc16(uint16_t crc, unsigned char byte);
+
+private:
+    int version;
+    unsigned long crcErrors, discardedBytes;
+
+    bool DecodeLegacy(RingBuffer &ring, Frame &frame);
+    bool DecodeFramed(RingBuffer &ring, Frame &frame);
+    static bool IsKnownType(unsigned char type);
+    static size_t PayloadLength(unsigned char type);
+    static int32_t PeekInt32(const RingBuffer &ring, size_t offset);
+};
+
+#endif // MMUAV_ARDUCOPTER_BRIDGE_STEPPER_PROTOCOL_H
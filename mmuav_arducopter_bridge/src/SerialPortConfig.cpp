@@ -0,0 +1,44 @@
+/******************************************************************************
+File name: SerialPortConfig.cpp
+Description: Linux specific serial port settings that are not reachable
+    through termios.h.
+******************************************************************************/
+
+#include <SerialPortConfig.h>
+
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include <linux/serial.h>
+#include <errno.h>
+
+// sys/ioctl.h pulls in the libc termios definitions
+extern "C" int ioctl(int fd, unsigned long request, ...);
+
+bool SetArbitraryBaudrate(int fd, int baudrate, int &actual)
+{
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) != 0) return false;
+
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = baudrate;
+    tio.c_ospeed = baudrate;
+    // Input speed is the same as output speed
+    tio.c_cflag &= ~(CBAUD << IBSHIFT);
+    tio.c_cflag |= BOTHER << IBSHIFT;
+    if (ioctl(fd, TCSETS2, &tio) != 0) return false;
+
+    // Driver rounds to the nearest speed its clock divider can produce
+    if (ioctl(fd, TCGETS2, &tio) != 0) return false;
+    actual = int(tio.c_ospeed);
+    return true;
+}
+
+bool SetLowLatency(int fd, bool enable)
+{
+    struct serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) return false;
+    if (enable) serial.flags |= ASYNC_LOW_LATENCY;
+    else serial.flags &= ~ASYNC_LOW_LATENCY;
+    return ioctl(fd, TIOCSSERIAL, &serial) == 0;
+}
@@ -0,0 +1,130 @@
+/******************************************************************************
+File name: SerialTransport.cpp
+Description: Stand-alone, ROS-free transport to one stepper board.
+******************************************************************************/
+
+#include <SerialTransport.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+SerialTransport::SerialTransport()
+{
+    epollFd = -1;
+    wakeFd = -1;
+    ioRunning = false;
+    memset(&counters, 0, sizeof counters);
+}
+
+SerialTransport::~SerialTransport()
+{
+    Close();
+}
+
+void SerialTransport::SetFrameCallback(const FrameCallback &callback)
+{
+    link.SetFrameCallback(callback);
+}
+
+bool SerialTransport::Open(const Settings &settings, std::string &error)
+{
+    Close();
+    if (!link.Open(settings, error)) return false;
+
+    epollFd = epoll_create1(0);
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (epollFd < 0 || wakeFd < 0)
+    {
+        error = std::string("unable to set up I/O thread: ") +
+            strerror(errno);
+        Close();
+        return false;
+    }
+
+    // The link is identified by its own address, the wake up fd by NULL
+    struct epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    link.Attach(epollFd, wakeFd, &link);
+
+    ioRunning = true;
+    ioThread = boost::thread(&SerialTransport::IoLoop, this);
+    return true;
+}
+
+void SerialTransport::Close()
+{
+    if (ioThread.joinable())
+    {
+        ioRunning = false;
+        Wake();
+        ioThread.join();
+    }
+    ioRunning = false;
+    link.Close();
+    if (epollFd >= 0) close(epollFd);
+    if (wakeFd >= 0) close(wakeFd);
+    epollFd = -1;
+    wakeFd = -1;
+}
+
+void SerialTransport::SendCommand(
+    const int32_t values[StepperProtocol::VALUES])
+{
+    link.QueueMotion(values, StepperLink::MonotonicNow());
+}
+
+void SerialTransport::SendParameters(
+    const int32_t values[StepperProtocol::VALUES])
+{
+    link.QueueParameters(values, StepperLink::MonotonicNow());
+}
+
+void SerialTransport::GetCounters(StepperLink::Counters &counters)
+{
+    boost::mutex::scoped_lock lock(countersMutex);
+    counters = this->counters;
+}
+
+void SerialTransport::Wake()
+{
+    if (wakeFd < 0) return;
+    uint64_t one = 1;
+    ssize_t temp = write(wakeFd, &one, sizeof one);
+    (void)temp;
+}
+
+void SerialTransport::IoLoop()
+{
+    struct epoll_event events[2];
+    StepperLink::Latencies latencies;
+    while (ioRunning && link.IsOpen())
+    {
+        int timeout = 100;
+        link.Service(timeout);
+
+        int n = epoll_wait(epollFd, events, 2, timeout);
+        for (int i = 0; i < n; i++)
+        {
+            if (events[i].data.ptr == NULL)
+            {
+                uint64_t count;
+                ssize_t temp = read(wakeFd, &count, sizeof count);
+                (void)temp;
+            }
+            else link.HandleEvents(events[i].events);
+        }
+
+        // Latencies are only collected by the ROS bridge, don't let them
+        // grow here.
+        link.TakeLatencies(latencies);
+        boost::mutex::scoped_lock lock(countersMutex);
+        link.GetCounters(counters);
+    }
+    ioRunning = false;
+}
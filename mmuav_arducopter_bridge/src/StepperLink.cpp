@@ -0,0 +1,450 @@
+/******************************************************************************
+File name: StepperLink.cpp
+Description: ROS-free serial link to one stepper board.
+******************************************************************************/
+
+#include <StepperLink.h>
+#include <SerialPortConfig.h>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+
+StepperLink::StepperLink() : txRing(64), rxRing(4096)
+{
+    USB = -1;
+    actualBaudrate = 0;
+    lowLatencySet = false;
+    motionPending = false;
+    epollFd = -1;
+    wakeFd = -1;
+    epollData = NULL;
+    waitingWritable = false;
+    maxOutputQueue = 0;
+    txSequence = 0;
+    txBuildTime = 0.0;
+    lastFeedbackSequence = -1;
+    for (int i = 0; i < 256; i++) commandAwaitingEcho[i] = false;
+    memset(&counters, 0, sizeof counters);
+}
+
+StepperLink::~StepperLink()
+{
+    Close();
+}
+
+double StepperLink::MonotonicNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return double(now.tv_sec) + 1e-9*double(now.tv_nsec);
+}
+
+bool StepperLink::Open(const Settings &settings, std::string &error)
+{
+    Close();
+    this->settings = settings;
+    protocol = StepperProtocol(settings.protocol);
+    maxOutputQueue = settings.maxOutputQueue > 0 ? settings.maxOutputQueue :
+        int(protocol.FrameLength());
+
+    if (settings.baudrate <= 0)
+    {
+        error = "invalid baudrate";
+        return false;
+    }
+
+    // Frame budget: the share of the link's frame rate (10 bits per byte)
+    // used for frames, optionally capped at maxCommandRate.
+    double frameRate = settings.linkBudget*settings.baudrate/
+        (10.0*protocol.FrameLength());
+    if (settings.maxCommandRate > 0.0)
+        frameRate = std::min(frameRate, settings.maxCommandRate);
+    budget.Configure(frameRate, 2.0);
+
+    // First open port, all I/O is non-blocking and driven by epoll
+    USB = open(settings.port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (USB < 0)
+    {
+        error = std::string("unable to open: ") + strerror(errno);
+        return false;
+    }
+
+    struct termios tty;
+    memset(&tty, 0, sizeof tty);
+    if (tcgetattr(USB, &tty) != 0)
+    {
+        error = std::string("tcgetattr failed: ") + strerror(errno);
+        Close();
+        return false;
+    }
+    // Save old tty parameter
+    tty_old = tty;
+
+    // Make raw
+    cfmakeraw(&tty);
+    tty.c_cflag     &=  ~PARENB; // No parity bit
+    tty.c_cflag     &=  ~CSTOPB; // One stop bit
+    tty.c_cflag     &=  ~CSIZE;
+    tty.c_cflag     |=  CS8;     // 8-bit characters are sent
+    tty.c_cflag     &=  ~CRTSCTS;           // no flow control
+    tty.c_cc[VMIN]   =  0;                  // read returns what is there
+    tty.c_cc[VTIME]  =  0;                  // no inter-byte timer
+    tty.c_cflag     |=  CREAD | CLOCAL;     // turn on READ & ignore ctrl lines
+
+    // Flush Port, then applies attributes
+    tcflush(USB, TCIOFLUSH);
+    if (tcsetattr(USB, TCSANOW, &tty) != 0)
+    {
+        error = std::string("tcsetattr failed: ") + strerror(errno);
+        Close();
+        return false;
+    }
+
+    // Any rate the UART clock can generate, not only the Bxxx constants
+    if (!SetArbitraryBaudrate(USB, settings.baudrate, actualBaudrate))
+    {
+        error = std::string("unable to set baudrate: ") + strerror(errno);
+        Close();
+        return false;
+    }
+    // UART framing tolerates a few percent, beyond that every byte is
+    // garbage on the other side.
+    if (abs(actualBaudrate - settings.baudrate) > settings.baudrate/50)
+    {
+        error = "baudrate not supported by the driver";
+        Close();
+        return false;
+    }
+
+    lowLatencySet = settings.lowLatency && SetLowLatency(USB, true);
+
+    memset(&counters, 0, sizeof counters);
+    latencies = Latencies();
+    txRing.Clear();
+    rxRing.Clear();
+    lastFeedbackSequence = -1;
+    for (int i = 0; i < 256; i++) commandAwaitingEcho[i] = false;
+    return true;
+}
+
+void StepperLink::Close()
+{
+    if (USB < 0) return;
+    if (epollFd >= 0) epoll_ctl(epollFd, EPOLL_CTL_DEL, USB, NULL);
+    close(USB);
+    USB = -1;
+    epollFd = -1;
+    wakeFd = -1;
+}
+
+void StepperLink::SetFrameCallback(const FrameCallback &callback)
+{
+    frameCallback = callback;
+}
+
+void StepperLink::QueueMotion(const int32_t values[StepperProtocol::VALUES],
+    double receivedTime)
+{
+    {
+        boost::mutex::scoped_lock lock(mailboxMutex);
+        counters.commandsReceived++;
+        if (motionPending) counters.motionReplaced++;
+        for (int i = 0; i < StepperProtocol::VALUES; i++)
+            motionFrame.frame.values[i] = values[i];
+        motionFrame.frame.type = StepperProtocol::COMMAND;
+        motionFrame.receivedTime = receivedTime;
+        motionPending = true;
+    }
+    Wake();
+}
+
+void StepperLink::QueueParameters(
+    const int32_t values[StepperProtocol::VALUES], double receivedTime)
+{
+    {
+        boost::mutex::scoped_lock lock(mailboxMutex);
+        counters.parametersReceived++;
+        // Oldest parameters are the least relevant ones
+        if (parameterQueue.size() >= PARAMETER_QUEUE_LENGTH)
+        {
+            parameterQueue.pop_front();
+            counters.parametersDropped++;
+        }
+        QueuedFrame frame;
+        for (int i = 0; i < StepperProtocol::VALUES; i++)
+            frame.frame.values[i] = values[i];
+        frame.frame.type = StepperProtocol::PARAMETERS;
+        frame.receivedTime = receivedTime;
+        parameterQueue.push_back(frame);
+    }
+    Wake();
+}
+
+bool StepperLink::HasPendingFrame()
+{
+    boost::mutex::scoped_lock lock(mailboxMutex);
+    return motionPending || !parameterQueue.empty();
+}
+
+bool StepperLink::TakeNextFrame(QueuedFrame &frame, double now)
+{
+    boost::mutex::scoped_lock lock(mailboxMutex);
+    // Motion has priority, parameters go out when there is no motion
+    // command or when they waited too long.
+    if (!parameterQueue.empty() && (!motionPending ||
+        now - parameterQueue.front().receivedTime >
+        settings.parameterMaxDelay))
+    {
+        frame = parameterQueue.front();
+        parameterQueue.pop_front();
+        return true;
+    }
+    if (motionPending)
+    {
+        frame = motionFrame;
+        motionPending = false;
+        return true;
+    }
+    return false;
+}
+
+void StepperLink::Attach(int epollFd, int wakeFd, void *data)
+{
+    this->epollFd = epollFd;
+    this->wakeFd = wakeFd;
+    epollData = data;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = EPOLLIN;
+    event.data.ptr = epollData;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, USB, &event);
+    waitingWritable = false;
+    rxRing.Clear();
+    budget.Reset(MonotonicNow());
+}
+
+void StepperLink::Wake()
+{
+    if (wakeFd < 0) return;
+    uint64_t one = 1;
+    ssize_t temp = write(wakeFd, &one, sizeof one);
+    (void)temp;
+}
+
+void StepperLink::SetWritableInterest(bool enable)
+{
+    if (enable == waitingWritable) return;
+    struct epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = EPOLLIN | (enable ? uint32_t(EPOLLOUT) : 0u);
+    event.data.ptr = epollData;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, USB, &event);
+    waitingWritable = enable;
+}
+
+void StepperLink::Service(int &timeout)
+{
+    if (USB < 0) return;
+
+    while (true)
+    {
+        // Take the next frame only when the previous one is out and the
+        // driver queue is short, so a frame is never sent stale.
+        if (txRing.Empty())
+        {
+            int queued = 0;
+            double wait = 0.0;
+            double now = MonotonicNow();
+            if (ioctl(USB, TIOCOUTQ, &queued) == 0 && queued > maxOutputQueue)
+            {
+                // Check again roughly when the queued bytes are sent
+                timeout = std::min(timeout,
+                    1 + int(10000LL*queued/settings.baudrate));
+            }
+            else if (!budget.Ready(now, wait))
+            {
+                // Pending commands keep being coalesced in the mailbox
+                if (HasPendingFrame())
+                {
+                    counters.throttled++;
+                    timeout = std::min(timeout, 1 + int(1000.0*wait));
+                }
+            }
+            else if (TakeNextFrame(txFrame, now))
+            {
+                budget.Consume();
+                txFrame.frame.sequence = txSequence++;
+                protocol.Encode(txFrame.frame, txRing);
+                txBuildTime = MonotonicNow();
+                latencies.queue.push_back(txBuildTime - txFrame.receivedTime);
+            }
+        }
+        if (txRing.Empty()) break;
+
+        // Frame is dropped on write error
+        int result = WritePending();
+        if (result < 0) txRing.Clear();
+        else if (result > 0) RecordWrite(MonotonicNow());
+        // Driver buffer is full, epoll reports when it drains
+        else break;
+    }
+    SetWritableInterest(!txRing.Empty());
+}
+
+bool StepperLink::HandleEvents(uint32_t events)
+{
+    if (USB < 0) return false;
+    if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP))) return true;
+
+    int received = ReadAvailable();
+    Frame frame;
+    while (protocol.Decode(rxRing, frame)) HandleFrame(frame);
+    // Device was unplugged, epoll would report it forever
+    if (received <= 0 && (events & EPOLLHUP))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+int StepperLink::WritePending()
+{
+    while (!txRing.Empty())
+    {
+        const unsigned char *span;
+        size_t length = txRing.ReadableSpan(&span);
+        ssize_t n = write(USB, span, length);
+        if (n > 0)
+        {
+            txRing.Consume(n);
+            counters.bytesWritten += n;
+            if (!txRing.Empty()) counters.shortWrites++;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        // Output buffer full, epoll tells when to continue
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+
+        counters.writeErrors++;
+        return -1;
+    }
+
+    counters.framesWritten++;
+    return 1;
+}
+
+int StepperLink::ReadAvailable()
+{
+    int total = 0;
+    while (true)
+    {
+        unsigned char *span;
+        size_t length = rxRing.WritableSpan(&span);
+        if (length == 0)
+        {
+            // Parser is behind, oldest bytes are the least relevant ones
+            counters.rxOverflows++;
+            rxRing.Consume(rxRing.Size()/2);
+            continue;
+        }
+
+        ssize_t n = read(USB, span, length);
+        if (n > 0)
+        {
+            rxRing.Commit(n);
+            counters.bytesRead += n;
+            total += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || errno == EAGAIN || errno == EWOULDBLOCK) return total;
+
+        counters.readErrors++;
+        return -1;
+    }
+}
+
+void StepperLink::HandleFrame(const Frame &frame)
+{
+    double now = MonotonicNow();
+    counters.framesRead++;
+
+    // Sequence numbers are only sent with the framed protocol
+    if (frame.type == StepperProtocol::FEEDBACK &&
+        protocol.GetVersion() == StepperProtocol::FRAMED)
+    {
+        if (lastFeedbackSequence >= 0)
+        {
+            counters.lostFeedback +=
+                (frame.sequence - lastFeedbackSequence - 1) & 0xFF;
+        }
+        lastFeedbackSequence = frame.sequence;
+
+        // Board echoes the last command it received in every feedback
+        // frame, only the first echo of a command is a round trip.
+        if (commandAwaitingEcho[frame.echoedSequence])
+        {
+            latencies.roundTrip.push_back(now -
+                commandReceivedTime[frame.echoedSequence]);
+            commandAwaitingEcho[frame.echoedSequence] = false;
+        }
+    }
+
+    if (frameCallback) frameCallback(frame, now);
+}
+
+void StepperLink::RecordWrite(double now)
+{
+    latencies.write.push_back(now - txBuildTime);
+
+    // Frame is on the wire once the driver queue drains. Without tcdrain()
+    // that is estimated from the bytes still queued, 10 bits per byte.
+    double wireTime = now;
+    int queued = 0;
+    if (settings.useTcdrain)
+    {
+        tcdrain(USB);
+        wireTime = MonotonicNow();
+    }
+    else if (ioctl(USB, TIOCOUTQ, &queued) == 0)
+        wireTime += 10.0*queued/settings.baudrate;
+    latencies.wire.push_back(wireTime - txFrame.receivedTime);
+
+    if (txFrame.frame.type == StepperProtocol::COMMAND &&
+        protocol.GetVersion() == StepperProtocol::FRAMED)
+    {
+        commandReceivedTime[txFrame.frame.sequence] = txFrame.receivedTime;
+        commandAwaitingEcho[txFrame.frame.sequence] = true;
+    }
+}
+
+void StepperLink::GetCounters(Counters &counters)
+{
+    {
+        boost::mutex::scoped_lock lock(mailboxMutex);
+        counters = this->counters;
+    }
+    counters.crcErrors = protocol.GetCrcErrors();
+    counters.discardedBytes = protocol.GetDiscardedBytes();
+}
+
+void StepperLink::TakeLatencies(Latencies &latencies)
+{
+    latencies.queue.swap(this->latencies.queue);
+    latencies.write.swap(this->latencies.write);
+    latencies.wire.swap(this->latencies.wire);
+    latencies.roundTrip.swap(this->latencies.roundTrip);
+    this->latencies.queue.clear();
+    this->latencies.write.clear();
+    this->latencies.wire.clear();
+    this->latencies.roundTrip.clear();
+}
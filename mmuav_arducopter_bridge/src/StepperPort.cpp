@@ -0,0 +1,280 @@
+/******************************************************************************
+File name: StepperPort.cpp
+Description: One stepper board on one serial port.
+******************************************************************************/
+
+#include <StepperPort.h>
+
+#include <algorithm>
+#include <string.h>
+#include <boost/bind.hpp>
+
+StepperPort::StepperPort(const std::string &name,
+    const ros::NodeHandle &nhParams, const ros::NodeHandle &nhTopics) :
+    name(name), nhParams(nhParams), nhTopics(nhTopics), server(nhParams)
+{
+    this->nhParams.param("port", settings.port, std::string("/dev/ttyUSB0"));
+    this->nhParams.param("baudrate", settings.baudrate, int(115200));
+    this->nhParams.param("low_latency", settings.lowLatency, bool(true));
+    // Keep retrying to open the port this long, e.g. until an emulator or
+    // a hotplugged adapter has created it [s]
+    this->nhParams.param("open_timeout", openTimeout, double(0.0));
+
+    this->nhParams.param("protocol", settings.protocol,
+        int(StepperProtocol::LEGACY));
+    if (settings.protocol != StepperProtocol::LEGACY &&
+        settings.protocol != StepperProtocol::FRAMED)
+    {
+        ROS_WARN("Unknown protocol %d, using legacy protocol.",
+            settings.protocol);
+        settings.protocol = StepperProtocol::LEGACY;
+    }
+    ROS_INFO("Port %s: using stepper protocol %d.", name.c_str(),
+        settings.protocol);
+
+    this->nhParams.param("steps_per_meter", stepsPerMeter, double(5066.0));
+    this->nhParams.param("max_output_queue", settings.maxOutputQueue,
+        int(StepperProtocol(settings.protocol).FrameLength()));
+    this->nhParams.param("statistics_period", statisticsPeriod, double(1.0));
+    this->nhParams.param("use_tcdrain", settings.useTcdrain, bool(false));
+
+    // Frame budget: the share of the link's frame rate (10 bits per byte)
+    // used for commands, optionally capped at ~max_command_rate.
+    this->nhParams.param("link_budget", settings.linkBudget, double(0.8));
+    this->nhParams.param("max_command_rate", settings.maxCommandRate,
+        double(0.0));
+    // Parameter frames wait for idle budget, at most this long [s]
+    this->nhParams.param("parameter_max_delay", settings.parameterMaxDelay,
+        double(0.1));
+
+    link.SetFrameCallback(boost::bind(&StepperPort::HandleFrame, this,
+        _1, _2));
+    memset(&windowStart, 0, sizeof windowStart);
+
+    all_mass_sub = this->nhTopics.subscribe("movable_mass_all/command", 1,
+        &StepperPort::allMassCallback, this);
+    feedback_pub = this->nhTopics.advertise<mmuav_msgs::StepperFeedback>(
+        "movable_mass_all/feedback", 1);
+    feedbackMsg.position.resize(StepperProtocol::VALUES);
+    feedbackMsg.steps.resize(StepperProtocol::VALUES);
+    statistics_pub = this->nhTopics.advertise<mmuav_msgs::SerialStatistics>(
+        "serial_statistics", 1);
+    statisticsMsg.baudrate = settings.baudrate;
+    statisticsMsg.percentiles.push_back(0.5);
+    statisticsMsg.percentiles.push_back(0.9);
+    statisticsMsg.percentiles.push_back(0.99);
+    statisticsMsg.percentiles.push_back(1.0);
+
+    f = boost::bind(&StepperPort::reconfigureCallback, this, _1, _2);
+    server.setCallback(f);
+}
+
+StepperPort::~StepperPort()
+{
+    Close();
+}
+
+bool StepperPort::Open()
+{
+    ROS_INFO("Setting up serial port %s parameters.", name.c_str());
+    std::string error;
+    ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(openTimeout);
+    bool open = link.Open(settings, error);
+    if (!open && openTimeout > 0.0)
+    {
+        ROS_INFO("Waiting up to %.1f s for serial port %s.", openTimeout,
+            settings.port.c_str());
+        while (!open && ros::ok() && ros::WallTime::now() < deadline)
+        {
+            ros::WallDuration(0.1).sleep();
+            open = link.Open(settings, error);
+        }
+    }
+    if (!open)
+    {
+        ROS_ERROR("Serial port %s (%s, %d baud): %s", name.c_str(),
+            settings.port.c_str(), settings.baudrate, error.c_str());
+        return false;
+    }
+
+    ROS_INFO("Setting baudrate to %d (actual %d).", settings.baudrate,
+        link.GetActualBaudrate());
+    if (settings.lowLatency && !link.IsLowLatency())
+    {
+        ROS_WARN("Low latency mode is not supported by %s.",
+            settings.port.c_str());
+    }
+    statisticsMsg.frame_budget = link.GetFrameBudget();
+    ROS_INFO("Port %s: frame budget %.1f frames/s.", name.c_str(),
+        link.GetFrameBudget());
+    ROS_INFO("Serial port %s successfully open!", settings.port.c_str());
+    return true;
+}
+
+void StepperPort::Close()
+{
+    link.Close();
+}
+
+void StepperPort::Attach(int epollFd, int wakeFd)
+{
+    link.Attach(epollFd, wakeFd, this);
+    statisticsStart = MonotonicNow();
+    link.GetCounters(windowStart);
+    link.TakeLatencies(latencies);
+}
+
+void StepperPort::Service(double now, int &timeout)
+{
+    if (!link.IsOpen()) return;
+    link.Service(timeout);
+
+    if (now - statisticsStart >= statisticsPeriod)
+        PublishStatistics(now);
+    else
+    {
+        int remaining = 1 + int(1000.0*(statisticsStart +
+            statisticsPeriod - now));
+        timeout = std::min(timeout, remaining);
+    }
+}
+
+void StepperPort::HandleEvents(uint32_t events)
+{
+    if (!link.HandleEvents(events))
+    {
+        ROS_ERROR("Serial port %s hung up, closing it.",
+            settings.port.c_str());
+    }
+}
+
+void StepperPort::HandleFrame(const Frame &frame, double receivedTime)
+{
+    if (frame.type != StepperProtocol::FEEDBACK) return;
+
+    feedbackMsg.header.stamp = ros::Time::now();
+    for (int i = 0; i < StepperProtocol::VALUES; i++)
+    {
+        feedbackMsg.steps[i] = frame.values[i];
+        feedbackMsg.position[i] = double(frame.values[i])/stepsPerMeter;
+    }
+    feedbackMsg.status = frame.status;
+    feedbackMsg.sequence = frame.sequence;
+    feedbackMsg.echoed_sequence = frame.echoedSequence;
+    feedbackMsg.lost_frames = link.GetLostFeedback();
+    feedback_pub.publish(feedbackMsg);
+}
+
+void StepperPort::Percentiles(std::vector<double> &samples,
+    const std::vector<double> &percentiles, std::vector<double> &result)
+{
+    result.clear();
+    if (samples.empty()) return;
+    for (size_t i = 0; i < percentiles.size(); i++)
+    {
+        size_t index = size_t(percentiles[i]*(samples.size() - 1) + 0.5);
+        std::nth_element(samples.begin(), samples.begin() + index,
+            samples.end());
+        result.push_back(samples[index]);
+    }
+}
+
+void StepperPort::PublishStatistics(double now)
+{
+    StepperLink::Counters counters;
+    link.GetCounters(counters);
+    link.TakeLatencies(latencies);
+
+    double window = now - statisticsStart;
+    // Bytes the line can carry in the window, 10 bits per byte (8N1)
+    double windowCapacityBytes = window*settings.baudrate/10.0;
+    unsigned long bytesWritten =
+        counters.bytesWritten - windowStart.bytesWritten;
+    unsigned long bytesRead = counters.bytesRead - windowStart.bytesRead;
+
+    statisticsMsg.header.stamp = ros::Time::now();
+    statisticsMsg.window = window;
+    statisticsMsg.tx_bytes_per_second = bytesWritten/window;
+    statisticsMsg.rx_bytes_per_second = bytesRead/window;
+    statisticsMsg.tx_frames_per_second =
+        (counters.framesWritten - windowStart.framesWritten)/window;
+    statisticsMsg.rx_frames_per_second =
+        (counters.framesRead - windowStart.framesRead)/window;
+    statisticsMsg.tx_utilization = bytesWritten/windowCapacityBytes;
+    statisticsMsg.rx_utilization = bytesRead/windowCapacityBytes;
+
+    statisticsMsg.offered_frames_per_second =
+        (counters.commandsReceived + counters.parametersReceived -
+        windowStart.commandsReceived - windowStart.parametersReceived)/window;
+    statisticsMsg.commands_received = counters.commandsReceived;
+    statisticsMsg.commands_replaced = counters.motionReplaced;
+    statisticsMsg.parameters_dropped = counters.parametersDropped;
+    statisticsMsg.write_errors = counters.writeErrors;
+    statisticsMsg.short_writes = counters.shortWrites;
+    statisticsMsg.crc_errors = counters.crcErrors;
+    statisticsMsg.discarded_bytes = counters.discardedBytes;
+    statisticsMsg.lost_feedback = counters.lostFeedback;
+    statisticsMsg.throttled = counters.throttled - windowStart.throttled;
+    double budget = link.GetFrameBudget();
+    statisticsMsg.saturation = budget > 0.0 ?
+        statisticsMsg.offered_frames_per_second/budget : 0.0;
+    if (statisticsMsg.saturation > 1.0)
+    {
+        ROS_WARN_THROTTLE(10.0, "Port %s saturated: %.0f frames/s offered, "
+            "budget is %.0f frames/s. Commands are coalesced.", name.c_str(),
+            statisticsMsg.offered_frames_per_second, budget);
+    }
+    if (counters.writeErrors > windowStart.writeErrors ||
+        counters.readErrors > windowStart.readErrors)
+    {
+        ROS_WARN_THROTTLE(1.0, "Serial I/O on %s failed: %lu write errors, "
+            "%lu read errors, %lu frames written.", settings.port.c_str(),
+            counters.writeErrors, counters.readErrors, counters.framesWritten);
+    }
+
+    Percentiles(latencies.queue, statisticsMsg.percentiles,
+        statisticsMsg.queue_latency);
+    Percentiles(latencies.write, statisticsMsg.percentiles,
+        statisticsMsg.write_latency);
+    Percentiles(latencies.wire, statisticsMsg.percentiles,
+        statisticsMsg.wire_latency);
+    Percentiles(latencies.roundTrip, statisticsMsg.percentiles,
+        statisticsMsg.round_trip_latency);
+    statistics_pub.publish(statisticsMsg);
+
+    statisticsStart = now;
+    windowStart = counters;
+}
+
+void StepperPort::allMassCallback(const std_msgs::Float64MultiArray &msg)
+{
+    double receivedTime = MonotonicNow();
+    if (msg.data.size() < StepperProtocol::VALUES)
+    {
+        ROS_WARN("Not enough data. Length: %d", int(msg.data.size()));
+        return;
+    }
+
+    int32_t m[StepperProtocol::VALUES];
+    for (int i = 0; i < StepperProtocol::VALUES; i++)
+    {
+        double position = std::max(-0.07, std::min(0.07, msg.data[i]));
+        m[i] = int32_t(stepsPerMeter*position);
+    }
+    link.QueueMotion(m, receivedTime);
+}
+
+void StepperPort::reconfigureCallback(Config &config, uint32_t level) {
+  
+  int32_t m[4] = {0,0,0,0};
+  ROS_INFO("Reconfigure Request %s: %d %d %d %d", name.c_str(),
+            config.gain, config.ang_speed_pps, 
+            config.ang_acc_pos_ppss, config.deadzone);
+  m[0] = config.gain;
+  m[1] = config.ang_speed_pps;
+  m[2] = config.ang_acc_pos_ppss;
+  m[3] = config.deadzone;
+
+  link.QueueParameters(m, MonotonicNow());
+
+}
@@ -0,0 +1,199 @@
+/******************************************************************************
+File name: StepperProtocol.cpp
+Description: Framing of messages between the bridge and the stepper board.
+******************************************************************************/
+
+#include <StepperProtocol.h>
+
+namespace
+{
+// CRC-16/CCITT-FALSE, polynomial 0x1021
+struct CrcTable
+{
+    uint16_t table[256];
+    CrcTable()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint16_t crc = uint16_t(i << 8);
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc & 0x8000) ? uint16_t((crc << 1) ^ 0x1021) :
+                    uint16_t(crc << 1);
+            table[i] = crc;
+        }
+    }
+};
+const CrcTable crcTable;
+}
+
+StepperProtocol::StepperProtocol(int version) :
+    version(version == FRAMED ? FRAMED : LEGACY),
+    crcErrors(0), discardedBytes(0)
+{
+}
+
+uint16_t StepperProtocol::Crc16(uint16_t crc, unsigned char byte)
+{
+    return uint16_t((crc << 8) ^ crcTable.table[((crc >> 8) ^ byte) & 0xFF]);
+}
+
+size_t StepperProtocol::PayloadLength(unsigned char type)
+{
+    // Feedback adds status and echoed sequence bytes
+    if (type == FEEDBACK) return 4*VALUES + 2;
+    return 4*VALUES;
+}
+
+size_t StepperProtocol::FrameLength(unsigned char type) const
+{
+    if (version == LEGACY) return LEGACY_FRAME_LENGTH;
+    return HEADER_LENGTH + PayloadLength(type) + CRC_LENGTH;
+}
+
+bool StepperProtocol::IsKnownType(unsigned char type)
+{
+    return type == COMMAND || type == PARAMETERS || type == FEEDBACK;
+}
+
+int32_t StepperProtocol::PeekInt32(const RingBuffer &ring, size_t offset)
+{
+    uint32_t value = uint32_t(ring.Peek(offset)) |
+        (uint32_t(ring.Peek(offset + 1)) << 8) |
+        (uint32_t(ring.Peek(offset + 2)) << 16) |
+        (uint32_t(ring.Peek(offset + 3)) << 24);
+    return int32_t(value);
+}
+
+bool StepperProtocol::Encode(const Frame &frame, RingBuffer &ring) const
+{
+    size_t length = FrameLength(frame.type);
+    size_t payload = PayloadLength(frame.type);
+    if (ring.Free() < length) return false;
+
+    size_t offset = 0;
+    uint16_t crc = 0xFFFF;
+    if (version == FRAMED)
+    {
+        unsigned char header[HEADER_LENGTH] = {START_BYTE_1, START_BYTE_2,
+            (unsigned char)FRAMED, frame.type, frame.sequence,
+            (unsigned char)payload};
+        for (size_t i = 0; i < HEADER_LENGTH; i++)
+        {
+            ring.Poke(offset++, header[i]);
+            if (i >= 2) crc = Crc16(crc, header[i]);
+        }
+    }
+
+    for (int i = 0; i < VALUES; i++)
+    {
+        uint32_t value = uint32_t(frame.values[i]);
+        for (int b = 0; b < 4; b++)
+        {
+            unsigned char byte = (unsigned char)(value >> (8*b));
+            ring.Poke(offset++, byte);
+            crc = Crc16(crc, byte);
+        }
+    }
+
+    if (version == FRAMED)
+    {
+        if (payload > 4*VALUES)
+        {
+            ring.Poke(offset++, frame.status);
+            ring.Poke(offset++, frame.echoedSequence);
+            crc = Crc16(crc, frame.status);
+            crc = Crc16(crc, frame.echoedSequence);
+        }
+        ring.Poke(offset++, (unsigned char)(crc & 0xFF));
+        ring.Poke(offset++, (unsigned char)(crc >> 8));
+    }
+    else
+    {
+        ring.Poke(offset++, frame.type);
+        ring.Poke(offset++, 0);
+        ring.Poke(offset++, 0);
+        ring.Poke(offset++, 0);
+    }
+
+    ring.Commit(length);
+    return true;
+}
+
+bool StepperProtocol::Decode(RingBuffer &ring, Frame &frame)
+{
+    if (version == FRAMED) return DecodeFramed(ring, frame);
+    return DecodeLegacy(ring, frame);
+}
+
+bool StepperProtocol::DecodeLegacy(RingBuffer &ring, Frame &frame)
+{
+    while (ring.Size() >= LEGACY_FRAME_LENGTH)
+    {
+        unsigned char type = ring.Peek(16);
+        if (IsKnownType(type) && ring.Peek(17) == 0 && ring.Peek(18) == 0 &&
+            ring.Peek(19) == 0)
+        {
+            frame.type = type;
+            frame.sequence = 0;
+            frame.status = 0;
+            frame.echoedSequence = 0;
+            for (int i = 0; i < VALUES; i++)
+                frame.values[i] = PeekInt32(ring, 4*i);
+            ring.Consume(LEGACY_FRAME_LENGTH);
+            return true;
+        }
+        // No sync information in the legacy frame, slide by one byte
+        ring.Consume(1);
+        discardedBytes++;
+    }
+    return false;
+}
+
+bool StepperProtocol::DecodeFramed(RingBuffer &ring, Frame &frame)
+{
+    while (ring.Size() >= HEADER_LENGTH)
+    {
+        size_t payload = ring.Peek(5);
+        if (ring.Peek(0) != START_BYTE_1 || ring.Peek(1) != START_BYTE_2 ||
+            ring.Peek(2) != FRAMED || payload > MAX_PAYLOAD)
+        {
+            ring.Consume(1);
+            discardedBytes++;
+            continue;
+        }
+
+        size_t length = HEADER_LENGTH + payload + CRC_LENGTH;
+        if (ring.Size() < length) return false;
+
+        // CRC is computed in place, the frame is never copied out
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 2; i < HEADER_LENGTH + payload; i++)
+            crc = Crc16(crc, ring.Peek(i));
+        uint16_t received = uint16_t(ring.Peek(HEADER_LENGTH + payload)) |
+            uint16_t(ring.Peek(HEADER_LENGTH + payload + 1) << 8);
+        if (crc != received)
+        {
+            // Start bytes may have been payload, resync from the next byte
+            crcErrors++;
+            ring.Consume(1);
+            discardedBytes++;
+            continue;
+        }
+
+        frame.type = ring.Peek(3);
+        frame.sequence = ring.Peek(4);
+        for (int i = 0; i < VALUES; i++)
+        {
+            if (HEADER_LENGTH + 4*i + 4 <= HEADER_LENGTH + payload)
+                frame.values[i] = PeekInt32(ring, HEADER_LENGTH + 4*i);
+            else frame.values[i] = 0;
+        }
+        size_t extra = HEADER_LENGTH + 4*VALUES;
+        frame.status = payload > 4*VALUES ? ring.Peek(extra) : 0;
+        frame.echoedSequence = payload > 4*VALUES + 1 ?
+            ring.Peek(extra + 1) : 0;
+        ring.Consume(length);
+        return true;
+    }
+    return false;
+}
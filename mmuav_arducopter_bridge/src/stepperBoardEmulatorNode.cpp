@@ -0,0 +1,365 @@
+/******************************************************************************
+File name: stepperBoardEmulatorNode.cpp
+Description: Emulates the movable mass stepper board on a pseudo terminal so
+    the serial bridge can be run and benchmarked without hardware. The slave
+    side of the pty is linked to ~link, point the bridge ~port there.
+
+    Command frames set mass targets, parameter frames set gain, speed,
+    acceleration and deadzone with the semantics of StepperParameters.cfg.
+    Every stepper is a proportional position loop with speed and
+    acceleration limits. Feedback frames are sent at ~feedback_rate.
+    The UART is emulated by reading and writing at most ~baudrate/10 bytes
+    per second, so the bridge sees a realistic driver queue.
+******************************************************************************/
+
+#include "ros/ros.h"
+
+#include <RingBuffer.h>
+#include <StepperProtocol.h>
+
+#include <deque>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+class StepperBoardEmulator
+{
+public:
+    StepperBoardEmulator() : rxRing(4096), txRing(4096)
+    {
+        nhParams = ros::NodeHandle("~");
+        nhParams.param("link", link, std::string("/tmp/ttyStepperBoard"));
+        nhParams.param("protocol", protocolVersion,
+            int(StepperProtocol::LEGACY));
+        nhParams.param("baudrate", baudrate, int(115200));
+        nhParams.param("feedback_rate", feedbackRate, double(100.0));
+        // Command processing delay of the board, uniform jitter on top
+        nhParams.param("latency", latency, double(0.001));
+        nhParams.param("latency_jitter", latencyJitter, double(0.0));
+        // Probability of a bit error in every transferred byte, both ways
+        nhParams.param("byte_error_rate", byteErrorRate, double(0.0));
+        // Mass travel limit, same as the clamp in the bridge
+        nhParams.param("limit_steps", limitSteps, double(355.0));
+        nhParams.param("step_rate", stepRate, double(1000.0));
+
+        // Defaults of StepperParameters.cfg
+        gain = 14;
+        speed = 1750;
+        acceleration = 18000;
+        deadzone = 5;
+        fault = false;
+
+        protocol = StepperProtocol(protocolVersion);
+        for (int i = 0; i < StepperProtocol::VALUES; i++)
+        {
+            target[i] = 0.0;
+            position[i] = 0.0;
+            velocity[i] = 0.0;
+        }
+        txSequence = 0;
+        lastCommandSequence = 0;
+        master = -1;
+        framesReceived = 0;
+        framesSent = 0;
+    }
+
+    ~StepperBoardEmulator()
+    {
+        if (master >= 0) close(master);
+        unlink(link.c_str());
+    }
+
+    bool openPty()
+    {
+        master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        {
+            ROS_ERROR("Unable to open pseudo terminal: %s", strerror(errno));
+            return false;
+        }
+
+        struct termios tty;
+        if (tcgetattr(master, &tty) == 0)
+        {
+            cfmakeraw(&tty);
+            tcsetattr(master, TCSANOW, &tty);
+        }
+
+        const char *slave = ptsname(master);
+        unlink(link.c_str());
+        if (symlink(slave, link.c_str()) != 0)
+        {
+            ROS_ERROR("Unable to link %s to %s: %s", link.c_str(), slave,
+                strerror(errno));
+            return false;
+        }
+        ROS_INFO("Stepper board emulator on %s (%s), protocol %d, "
+            "%d baud.", link.c_str(), slave, protocol.GetVersion(), baudrate);
+        return true;
+    }
+
+    void run()
+    {
+        if (!openPty()) return;
+
+        double dt = 1.0/stepRate;
+        double bytesPerTick = baudrate/10.0*dt;
+        double rxBudget = 0.0, txBudget = 0.0;
+        double now = monotonicNow();
+        double nextFeedback = now;
+        double nextReport = now + 5.0;
+
+        struct timespec wakeup;
+        clock_gettime(CLOCK_MONOTONIC, &wakeup);
+        while (ros::ok())
+        {
+            // Phase-locked tick, same as a timer interrupt on the board
+            wakeup.tv_nsec += long(1e9*dt);
+            while (wakeup.tv_nsec >= 1000000000L)
+            {
+                wakeup.tv_nsec -= 1000000000L;
+                wakeup.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
+            now = monotonicNow();
+
+            // Budgets are capped so an idle line can't burst afterwards
+            double maxBudget = 2.0*bytesPerTick + 1.0;
+            rxBudget = std::min(rxBudget + bytesPerTick, maxBudget);
+            txBudget = std::min(txBudget + bytesPerTick, maxBudget);
+
+            receive(rxBudget, now);
+            applyCommands(now);
+            step(dt);
+
+            if (feedbackRate > 0.0 && now >= nextFeedback)
+            {
+                queueFeedback();
+                nextFeedback += 1.0/feedbackRate;
+                if (nextFeedback < now) nextFeedback = now + 1.0/feedbackRate;
+            }
+            transmit(txBudget);
+
+            if (now >= nextReport)
+            {
+                ROS_INFO("Emulator: %lu frames received, %lu sent, %lu CRC "
+                    "errors, %lu bytes discarded.", framesReceived, framesSent,
+                    protocol.GetCrcErrors(), protocol.GetDiscardedBytes());
+                nextReport += 5.0;
+            }
+        }
+    }
+
+private:
+    ros::NodeHandle nhParams;
+    std::string link;
+    int protocolVersion, baudrate;
+    double feedbackRate, latency, latencyJitter, byteErrorRate;
+    double limitSteps, stepRate;
+
+    // Board state, positions in steps
+    int gain, speed, acceleration, deadzone;
+    bool fault;
+    double target[StepperProtocol::VALUES];
+    double position[StepperProtocol::VALUES];
+    double velocity[StepperProtocol::VALUES];
+
+    int master;
+    StepperProtocol protocol;
+    RingBuffer rxRing, txRing;
+    unsigned char txSequence, lastCommandSequence;
+    unsigned long framesReceived, framesSent;
+    unsigned char line[256];
+
+    // Frames waiting for the emulated processing delay
+    struct PendingFrame
+    {
+        StepperProtocol::Frame frame;
+        double applyTime;
+    };
+    std::deque<PendingFrame> pending;
+
+    static double monotonicNow()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return double(now.tv_sec) + 1e-9*double(now.tv_nsec);
+    }
+
+    void corrupt(unsigned char *data, size_t length)
+    {
+        if (byteErrorRate <= 0.0) return;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (double(rand())/RAND_MAX < byteErrorRate)
+                data[i] ^= (unsigned char)(1 << (rand() % 8));
+        }
+    }
+
+    void receive(double &budget, double now)
+    {
+        while (budget >= 1.0)
+        {
+            unsigned char *span;
+            size_t length = rxRing.WritableSpan(&span);
+            length = std::min(length, size_t(budget));
+            if (length == 0) break;
+
+            // EIO while no process has the slave side open
+            ssize_t n = read(master, span, length);
+            if (n <= 0) break;
+            corrupt(span, n);
+            rxRing.Commit(n);
+            budget -= n;
+        }
+
+        StepperProtocol::Frame frame;
+        while (protocol.Decode(rxRing, frame))
+        {
+            framesReceived++;
+            PendingFrame item;
+            item.frame = frame;
+            item.applyTime = now + latency +
+                latencyJitter*double(rand())/RAND_MAX;
+            // Board processes frames in order
+            if (!pending.empty() && item.applyTime < pending.back().applyTime)
+                item.applyTime = pending.back().applyTime;
+            pending.push_back(item);
+        }
+    }
+
+    void applyCommands(double now)
+    {
+        while (!pending.empty() && pending.front().applyTime <= now)
+        {
+            const StepperProtocol::Frame &frame = pending.front().frame;
+            if (frame.type == StepperProtocol::COMMAND)
+            {
+                for (int i = 0; i < StepperProtocol::VALUES; i++)
+                    target[i] = std::max(-limitSteps,
+                        std::min(limitSteps, double(frame.values[i])));
+                lastCommandSequence = frame.sequence;
+            }
+            else if (frame.type == StepperProtocol::PARAMETERS)
+                setParameters(frame.values);
+            pending.pop_front();
+        }
+    }
+
+    void setParameters(const int32_t values[StepperProtocol::VALUES])
+    {
+        // Out of range parameters are rejected and flagged as a fault,
+        // ranges are the ones in StepperParameters.cfg.
+        if (values[0] < 0 || values[0] > 20 || values[1] < 0 ||
+            values[1] > 2400 || values[2] < 0 || values[2] > 20000 ||
+            values[3] < 0 || values[3] > 400)
+        {
+            ROS_WARN("Emulator: parameters out of range: %d %d %d %d",
+                values[0], values[1], values[2], values[3]);
+            fault = true;
+            return;
+        }
+        gain = values[0];
+        speed = values[1];
+        acceleration = values[2];
+        deadzone = values[3];
+        fault = false;
+        ROS_INFO("Emulator: gain %d, speed %d pps, acceleration %d ppss, "
+            "deadzone %d.", gain, speed, acceleration, deadzone);
+    }
+
+    void step(double dt)
+    {
+        double maxDeltaV = acceleration*dt;
+        for (int i = 0; i < StepperProtocol::VALUES; i++)
+        {
+            double error = target[i] - position[i];
+            double desired = 0.0;
+            if (!fault && std::fabs(error) > deadzone)
+                desired = std::max(-double(speed),
+                    std::min(double(speed), gain*error));
+
+            // Speed may not overshoot the remaining distance
+            double stopping = std::sqrt(2.0*acceleration*std::fabs(error));
+            desired = std::max(-stopping, std::min(stopping, desired));
+
+            velocity[i] += std::max(-maxDeltaV,
+                std::min(maxDeltaV, desired - velocity[i]));
+            position[i] += velocity[i]*dt;
+            position[i] = std::max(-limitSteps,
+                std::min(limitSteps, position[i]));
+        }
+    }
+
+    unsigned char status() const
+    {
+        unsigned char flags = 0;
+        for (int i = 0; i < StepperProtocol::VALUES; i++)
+        {
+            if (std::fabs(velocity[i]) > 0.5) flags |= 1;
+            if (std::fabs(position[i]) >= limitSteps) flags |= 2;
+        }
+        if (fault) flags |= 4;
+        return flags;
+    }
+
+    void queueFeedback()
+    {
+        StepperProtocol::Frame frame;
+        frame.type = StepperProtocol::FEEDBACK;
+        frame.sequence = txSequence;
+        for (int i = 0; i < StepperProtocol::VALUES; i++)
+            frame.values[i] = int32_t(std::floor(position[i] + 0.5));
+        // The legacy protocol has no room for status and echo
+        bool legacy = protocol.GetVersion() == StepperProtocol::LEGACY;
+        frame.status = legacy ? 0 : status();
+        frame.echoedSequence = legacy ? 0 : lastCommandSequence;
+
+        // A board with a full UART buffer skips feedback, it never queues
+        // stale positions.
+        if (protocol.Encode(frame, txRing))
+        {
+            txSequence++;
+            framesSent++;
+        }
+    }
+
+    void transmit(double &budget)
+    {
+        while (budget >= 1.0 && !txRing.Empty())
+        {
+            const unsigned char *span;
+            size_t length = txRing.ReadableSpan(&span);
+            length = std::min(length, std::min(size_t(budget), sizeof line));
+
+            // Errors are injected on a copy, a partially written chunk is
+            // not corrupted twice.
+            memcpy(line, span, length);
+            corrupt(line, length);
+            ssize_t n = write(master, line, length);
+            if (n <= 0)
+            {
+                // Nobody is listening, drop what the board would have sent
+                if (n < 0 && errno == EIO) txRing.Clear();
+                break;
+            }
+            txRing.Consume(n);
+            budget -= n;
+        }
+    }
+};
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "stepperBoardEmulatorNode");
+    StepperBoardEmulator emulator;
+    emulator.run();
+    return 0;
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+File name: MinSnapPlanner.h
+Description: Minimum snap polynomial trajectory planner for x, y, z and yaw.
+    Sparse replacement for the dense numpy matrices in trajectory_planner.py.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_MIN_SNAP_PLANNER_H
+#define MMUAV_CONTROL_MIN_SNAP_PLANNER_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
+
+// Piecewise polynomial trajectory. Every segment is parametrized in
+// normalized time tau = t/T[i] in [0, 1], coefficients are in ascending
+// powers of tau: p(tau) = c[0] + c[1]*tau + ... + c[n]*tau^n.
+struct PolynomialTrajectory
+{
+    enum { X = 0, Y = 1, Z = 2, YAW = 3, AXES = 4 };
+
+    int polyOrder;
+    // Segment durations [s]
+    Eigen::VectorXd T;
+    // One (polyOrder+1) x segments matrix per axis
+    Eigen::MatrixXd coefficients[AXES];
+
+    PolynomialTrajectory() : polyOrder(0) {}
+    int segments() const { return int(T.size()); }
+    double duration() const { return T.sum(); }
+
+    // Returns derivative of the given order (0 - position, 1 - velocity...)
+    // of all axes at time t from the start of the trajectory. t is clamped
+    // to [0, duration()].
+    Eigen::Vector4d evaluate(double t, int derivative) const;
+    // Finds the segment containing t, returns normalized time in it.
+    double locate(double t, int &segment) const;
+};
+
+class MinSnapPlanner
+{
+public:
+    // polyOrder         polynomial order of every segment
+    // derivativeOrder   derivatives kept continuous at keyframes for x, y, z
+    // derivativeOrderYaw derivatives kept continuous at keyframes for yaw
+    // costOrder         derivative minimized by the cost function (4 - snap)
+    MinSnapPlanner(int polyOrder = 9, int derivativeOrder = 4,
+        int derivativeOrderYaw = 2, int costOrder = 4);
+
+    // Plans trajectory through keyframes (4 x (segments+1), rows x, y, z,
+    // yaw) with segment durations T. Trajectory starts and ends at rest.
+    // Returns false if the system could not be factorized.
+    bool plan(const Eigen::MatrixXd &keyframes, const Eigen::VectorXd &T,
+        PolynomialTrajectory &trajectory);
+
+    // Total cost (sum over all axes) of the last successful plan.
+    double getCost() const { return cost; }
+    int getPolyOrder() const { return polyOrder; }
+
+    // Approximate segment times based on the largest per-axis distance
+    // between keyframes, same as generate_T in trajectory_planner.py.
+    static Eigen::VectorXd generateT(const Eigen::MatrixXd &keyframes,
+        double nominalSpeed = 1.0, double minSegmentTime = 0.1);
+    // Shifts yaw keyframes by multiples of 2*pi so that the vehicle always
+    // turns the short way between consecutive keyframes.
+    static void unwrapYaw(Eigen::MatrixXd &keyframes);
+
+private:
+    typedef Eigen::SparseMatrix<double> SparseMatrix;
+    typedef Eigen::Triplet<double> Triplet;
+
+    // Axes sharing the same constraint structure share one KKT factorization.
+    struct AxisGroup
+    {
+        int firstAxis, axes;
+        int derivativeOrder;    // continuity order at inner keyframes
+        int endOrder;           // derivatives fixed to zero at start and end
+        int patternSegments;    // segment count of the analyzed pattern
+        std::vector<Triplet> triplets;
+        SparseMatrix kkt;
+        Eigen::SparseLU<SparseMatrix, Eigen::COLAMDOrdering<int> > solver;
+        Eigen::MatrixXd rhs, solution;
+    };
+
+    int polyOrder, costOrder;
+    double cost;
+    AxisGroup position, yaw;
+    // Cost matrix of a single segment in normalized time, without T scaling
+    Eigen::MatrixXd unitCost;
+    // derivativeFactor(k, j) = j!/(j-k)!, coefficient of tau^(j-k) in the
+    // k-th derivative of tau^j
+    Eigen::MatrixXd derivativeFactor;
+
+    void initGroup(AxisGroup &group, int firstAxis, int axes,
+        int derivativeOrder);
+    int constraintCount(const AxisGroup &group, int segments) const;
+    void assemble(AxisGroup &group, const Eigen::MatrixXd &keyframes,
+        const Eigen::VectorXd &T);
+    bool solve(AxisGroup &group, const Eigen::MatrixXd &keyframes,
+        const Eigen::VectorXd &T, PolynomialTrajectory &trajectory);
+    void addDerivative(AxisGroup &group, int row, int segment, int k,
+        bool atEnd, double T, double scale);
+};
+
+#endif // MMUAV_CONTROL_MIN_SNAP_PLANNER_H
@@ -0,0 +1,74 @@
+/******************************************************************************
+File name: PeriodicExecutor.h
+Description: Phase-locked periodic loop for controller nodes. Wakes up on
+    simulated or wall clock (whatever ros::Time runs on) at t0 + k*Ts, passes
+    the measured dt to the control law and publishes period and jitter
+    statistics.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_PERIODIC_EXECUTOR_H
+#define MMUAV_CONTROL_PERIODIC_EXECUTOR_H
+
+#include "ros/ros.h"
+
+#include <vector>
+#include <string>
+#include <boost/function.hpp>
+
+#include <mmuav_msgs/LoopStatistics.h>
+
+class PeriodicExecutor
+{
+public:
+    // Control law gets the wake-up time and the measured time since the
+    // previous wake-up. It is never called with dt <= 0.
+    typedef boost::function<void(const ros::Time &now, double dt)> ControlLaw;
+
+    // Loop parameters are read from the private namespace of nhParams:
+    //  ~rate                  loop rate [Hz], defaultRate if not set
+    //  ~statistics_period     how often statistics are published [s]
+    //  ~histogram_bins        number of bins in period and jitter histograms
+    //  ~histogram_range       period histogram spans Ts*(1 -+ range),
+    //                         jitter histogram spans [0, Ts*range]
+    // Statistics are published on nhTopics/statisticsTopic.
+    PeriodicExecutor(ros::NodeHandle &nhParams, ros::NodeHandle &nhTopics,
+        double defaultRate, std::string statisticsTopic = "loop_statistics");
+
+    // Blocks until ros::Time is valid (first /clock message in simulation).
+    // Returns false if the node is shut down while waiting.
+    bool waitForClock();
+
+    // Runs the loop until ros shutdown. Pending callbacks are processed with
+    // ros::spinOnce() right after every wake-up, before the control law,
+    // unless processCallbacks is false (when an AsyncSpinner is used).
+    void spin(const ControlLaw &controlLaw, bool processCallbacks = true);
+
+    double getRate() const { return rate; }
+    double getPeriod() const { return period; }
+    unsigned int getMissedDeadlines() const { return missedDeadlinesTotal; }
+
+private:
+    double rate, period;
+    double statisticsPeriod;
+    int histogramBins;
+    double histogramRange;
+
+    // Phase-locked schedule, deadline k is at startTime + k*period
+    ros::Time startTime;
+    unsigned long long cycle;
+    unsigned int missedDeadlinesTotal;
+
+    ros::Publisher statisticsPub;
+    mmuav_msgs::LoopStatistics statisticsMsg;
+    ros::Time windowStart;
+    double periodSum, jitterSum;
+    double minPeriod, maxPeriod, maxJitter;
+    unsigned int windowIterations, windowMissed;
+
+    void resetStatistics(const ros::Time &now);
+    void recordIteration(double measuredPeriod, double jitter);
+    void publishStatistics(const ros::Time &now);
+    static void addToHistogram(std::vector<unsigned int> &histogram,
+        double value, double minValue, double binWidth);
+};
+
+#endif // MMUAV_CONTROL_PERIODIC_EXECUTOR_H
@@ -0,0 +1,58 @@
+/******************************************************************************
+File name: PolynomialTrajectorySampler.h
+Description: Evaluates position, velocity and acceleration of a piecewise
+    polynomial trajectory on demand. Coefficients of all four axes are
+    packed together so a single Horner pass evaluates x, y, z and yaw.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_POLYNOMIAL_TRAJECTORY_SAMPLER_H
+#define MMUAV_CONTROL_POLYNOMIAL_TRAJECTORY_SAMPLER_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+#include <mmuav_control/MinSnapPlanner.h>
+#include <mmuav_msgs/PolynomialTrajectory.h>
+#include <trajectory_msgs/MultiDOFJointTrajectoryPoint.h>
+
+class PolynomialTrajectorySampler
+{
+public:
+    // Rows are x, y, z and yaw
+    struct Sample
+    {
+        Eigen::Array4d position, velocity, acceleration;
+    };
+
+    PolynomialTrajectorySampler();
+
+    void setTrajectory(const PolynomialTrajectory &trajectory);
+    bool empty() const { return segmentTime.empty(); }
+    double duration() const;
+
+    // Evaluates the trajectory at time t from its start, t is clamped to
+    // [0, duration()]. Consecutive calls with increasing t find their
+    // segment in constant time.
+    void sample(double t, Sample &result) const;
+
+    static void toMsg(const PolynomialTrajectory &trajectory,
+        mmuav_msgs::PolynomialTrajectory &msg);
+    // Returns false if array sizes in the message are inconsistent.
+    static bool fromMsg(const mmuav_msgs::PolynomialTrajectory &msg,
+        PolynomialTrajectory &trajectory);
+    // Fills a trajectory point as expected on trajectory_point_ref.
+    static void toPointMsg(const Sample &sample, double t,
+        trajectory_msgs::MultiDOFJointTrajectoryPoint &point);
+
+private:
+    typedef std::vector<Eigen::Array4d,
+        Eigen::aligned_allocator<Eigen::Array4d> > PackedCoefficients;
+
+    int polyOrder;
+    std::vector<double> segmentStart, segmentTime;
+    // Coefficient of tau^j for all axes of segment i at i*(polyOrder+1) + j
+    PackedCoefficients coefficients;
+    mutable size_t lastSegment;
+};
+
+#endif // MMUAV_CONTROL_POLYNOMIAL_TRAJECTORY_SAMPLER_H
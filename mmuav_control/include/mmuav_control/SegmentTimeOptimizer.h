@@ -0,0 +1,56 @@
+/******************************************************************************
+File name: SegmentTimeOptimizer.h
+Description: Gradient based segment time refinement for MinSnapPlanner.
+    Total trajectory duration is kept, time is moved between segments to
+    lower the snap cost. Perturbation solves run on a thread pool.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_SEGMENT_TIME_OPTIMIZER_H
+#define MMUAV_CONTROL_SEGMENT_TIME_OPTIMIZER_H
+
+#include <memory>
+#include <vector>
+
+#include <mmuav_control/MinSnapPlanner.h>
+#include <mmuav_control/ThreadPool.h>
+
+class SegmentTimeOptimizer
+{
+public:
+    SegmentTimeOptimizer(int polyOrder = 9, int derivativeOrder = 4,
+        int derivativeOrderYaw = 2, int threads = 0);
+
+    void setMaxIterations(int iterations) { maxIterations = iterations; }
+    // Wall time budget for a single optimize() call [s]
+    void setTimeBudget(double budget) { timeBudget = budget; }
+    void setMinSegmentTime(double time) { minSegmentTime = time; }
+
+    // Refines segment times T in place starting from the given guess and
+    // plans the trajectory with the final times. Sum of T is preserved.
+    // Returns false if planning with the initial times fails.
+    bool optimize(const Eigen::MatrixXd &keyframes, Eigen::VectorXd &T,
+        PolynomialTrajectory &trajectory);
+
+    int getIterations() const { return iterations; }
+    double getInitialCost() const { return initialCost; }
+    double getCost() const { return cost; }
+
+private:
+    int maxIterations;
+    double timeBudget, minSegmentTime;
+    int iterations;
+    double initialCost, cost;
+
+    ThreadPool pool;
+    // One planner and one scratch trajectory per worker. Planners keep
+    // their analyzed sparsity pattern between iterations.
+    std::vector<std::unique_ptr<MinSnapPlanner> > planners;
+    std::vector<PolynomialTrajectory> scratch;
+    Eigen::VectorXd gradient, candidateCosts;
+    std::vector<Eigen::VectorXd> candidates;
+
+    void perturbationTask(int worker, int index, const Eigen::MatrixXd *keyframes,
+        const Eigen::VectorXd *T, double step);
+    void candidateTask(int worker, int index, const Eigen::MatrixXd *keyframes);
+};
+
+#endif // MMUAV_CONTROL_SEGMENT_TIME_OPTIMIZER_H
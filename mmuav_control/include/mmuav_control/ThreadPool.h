@@ -0,0 +1,43 @@
+/******************************************************************************
+File name: ThreadPool.h
+Description: Fixed size pool of worker threads running parallel for loops.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_THREAD_POOL_H
+#define MMUAV_CONTROL_THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <boost/function.hpp>
+
+class ThreadPool
+{
+public:
+    // threads <= 0 uses one thread per hardware core.
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    int size() const { return int(workers.size()); }
+
+    // Calls task(worker, index) for every index in [0, count) and blocks
+    // until all calls have returned. Worker is in [0, size()) and can be
+    // used to index per-thread scratch data.
+    void parallelFor(int count,
+        const boost::function<void(int worker, int index)> &task);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCondition, doneCondition;
+    boost::function<void(int, int)> currentTask;
+    std::atomic<int> nextIndex;
+    int taskCount, activeWorkers;
+    unsigned long generation;
+    bool stopping;
+
+    void workerLoop(int worker);
+};
+
+#endif // MMUAV_CONTROL_THREAD_POOL_H
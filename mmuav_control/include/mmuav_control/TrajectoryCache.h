@@ -0,0 +1,77 @@
+/******************************************************************************
+File name: TrajectoryCache.h
+Description: LRU cache of planned trajectories. Keyframes are stored relative
+    to the first keyframe position and yaw, so translated and yaw-rotated
+    copies of an already planned shape are served from the cache.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_TRAJECTORY_CACHE_H
+#define MMUAV_CONTROL_TRAJECTORY_CACHE_H
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include <mmuav_control/MinSnapPlanner.h>
+
+class TrajectoryCache
+{
+public:
+    // capacity   maximum number of stored trajectories, 0 disables caching
+    // tolerance  keyframes and segment times closer than this are treated
+    //            as equal [m, rad, s]
+    TrajectoryCache(size_t capacity = 32, double tolerance = 1e-4);
+
+    // Looks up a trajectory planned through keyframes with initial segment
+    // times T. On a hit the stored trajectory is moved to the keyframes and
+    // returned in trajectory.
+    bool lookup(const Eigen::MatrixXd &keyframes, const Eigen::VectorXd &T,
+        int polyOrder, PolynomialTrajectory &trajectory);
+    void insert(const Eigen::MatrixXd &keyframes, const Eigen::VectorXd &T,
+        int polyOrder, const PolynomialTrajectory &trajectory);
+    void clear();
+
+    // Keyframes in the frame of the first keyframe (its position and yaw
+    // are zero). Segment times generated from these are the same for all
+    // translated and yaw-rotated copies, so the copies share a cache key.
+    static Eigen::MatrixXd normalize(const Eigen::MatrixXd &keyframes);
+
+    size_t size() const { return entries.size(); }
+    unsigned long getHits() const { return hits; }
+    unsigned long getMisses() const { return misses; }
+
+private:
+    typedef std::vector<long long> Key;
+
+    struct Entry
+    {
+        Key key;
+        size_t hash;
+        // Trajectory planned through the normalized keyframes
+        PolynomialTrajectory trajectory;
+    };
+
+    // Rigid transform to the normalized frame: origin at the first
+    // keyframe, x axis along its yaw.
+    struct Frame
+    {
+        Eigen::Vector3d origin;
+        double yaw;
+    };
+
+    size_t capacity;
+    double tolerance;
+    unsigned long hits, misses;
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<size_t, std::list<Entry>::iterator> index;
+
+    static Frame frameOf(const Eigen::MatrixXd &keyframes);
+    Key makeKey(const Eigen::MatrixXd &keyframes, const Eigen::VectorXd &T,
+        int polyOrder) const;
+    static size_t hashKey(const Key &key);
+    // direction > 0 transforms from the normalized frame to the given frame,
+    // direction < 0 the other way around.
+    static void transform(PolynomialTrajectory &trajectory, const Frame &frame,
+        int direction);
+};
+
+#endif // MMUAV_CONTROL_TRAJECTORY_CACHE_H
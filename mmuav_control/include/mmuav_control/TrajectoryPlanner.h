@@ -0,0 +1,46 @@
+/******************************************************************************
+File name: TrajectoryPlanner.h
+Description: ROS node planning minimum snap trajectories through keyframes
+    received on multi_dof_trajectory.
+******************************************************************************/
+#ifndef MMUAV_CONTROL_TRAJECTORY_PLANNER_H
+#define MMUAV_CONTROL_TRAJECTORY_PLANNER_H
+
+#include "ros/ros.h"
+
+#include <memory>
+#include <mmuav_control/MinSnapPlanner.h>
+#include <mmuav_control/SegmentTimeOptimizer.h>
+#include <mmuav_control/PolynomialTrajectorySampler.h>
+#include <mmuav_control/TrajectoryCache.h>
+
+#include <trajectory_msgs/MultiDOFJointTrajectory.h>
+#include <trajectory_msgs/MultiDOFJointTrajectoryPoint.h>
+
+class TrajectoryPlanner
+{
+public:
+    TrajectoryPlanner();
+    void run();
+
+    // Fills msg with trajectory sampled at the given rate.
+    static void sampleTrajectory(const PolynomialTrajectory &trajectory,
+        double rate, trajectory_msgs::MultiDOFJointTrajectory &msg);
+
+private:
+    std::unique_ptr<MinSnapPlanner> planner;
+    std::unique_ptr<SegmentTimeOptimizer> timeOptimizer;
+    std::unique_ptr<TrajectoryCache> cache;
+    PolynomialTrajectory trajectory;
+    double nominalSpeed, minSegmentTime, rate;
+    bool publishSampled;
+
+    ros::NodeHandle nhParams, nhTopics;
+    ros::Subscriber keyframes_sub;
+    ros::Publisher trajectory_pub, polynomial_trajectory_pub;
+    trajectory_msgs::MultiDOFJointTrajectory trajectoryMsg;
+    mmuav_msgs::PolynomialTrajectory polynomialTrajectoryMsg;
+    void keyframesCallback(const trajectory_msgs::MultiDOFJointTrajectory &msg);
+};
+
+#endif // MMUAV_CONTROL_TRAJECTORY_PLANNER_H
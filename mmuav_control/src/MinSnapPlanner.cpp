@@ -0,0 +1,267 @@
+/******************************************************************************
+File name: MinSnapPlanner.cpp
+Description: Minimum snap polynomial trajectory planner for x, y, z and yaw.
+******************************************************************************/
+
+#include <mmuav_control/MinSnapPlanner.h>
+
+#include <cmath>
+#include <algorithm>
+
+double PolynomialTrajectory::locate(double t, int &segment) const
+{
+    segment = 0;
+    if (t <= 0.0 || T.size() == 0) return 0.0;
+    while (segment < T.size() - 1 && t > T(segment))
+    {
+        t -= T(segment);
+        segment++;
+    }
+    return std::min(t/T(segment), 1.0);
+}
+
+Eigen::Vector4d PolynomialTrajectory::evaluate(double t, int derivative) const
+{
+    Eigen::Vector4d result = Eigen::Vector4d::Zero();
+    if (T.size() == 0 || derivative > polyOrder) return result;
+
+    int segment;
+    double tau = locate(t, segment);
+    double timeScale = std::pow(T(segment), -derivative);
+
+    for (int axis = 0; axis < AXES; axis++)
+    {
+        // Horner scheme on the derivative polynomial
+        double value = 0.0;
+        for (int j = polyOrder; j >= derivative; j--)
+        {
+            double factor = 1.0;
+            for (int i = 0; i < derivative; i++) factor *= double(j - i);
+            value = value*tau + factor*coefficients[axis](j, segment);
+        }
+        result(axis) = value*timeScale;
+    }
+    return result;
+}
+
+MinSnapPlanner::MinSnapPlanner(int polyOrder, int derivativeOrder,
+    int derivativeOrderYaw, int costOrder) :
+    polyOrder(polyOrder), costOrder(costOrder), cost(0.0)
+{
+    int m = polyOrder + 1;
+    derivativeFactor = Eigen::MatrixXd::Zero(m, m);
+    for (int k = 0; k < m; k++)
+    {
+        for (int j = k; j < m; j++)
+        {
+            double factor = 1.0;
+            for (int i = 0; i < k; i++) factor *= double(j - i);
+            derivativeFactor(k, j) = factor;
+        }
+    }
+
+    // Integral over tau in [0, 1] of squared costOrder-th derivative
+    unitCost = Eigen::MatrixXd::Zero(m, m);
+    for (int j = costOrder; j < m; j++)
+    {
+        for (int l = costOrder; l < m; l++)
+        {
+            unitCost(j, l) = derivativeFactor(costOrder, j)*
+                derivativeFactor(costOrder, l)/double(j + l - 2*costOrder + 1);
+        }
+    }
+
+    initGroup(position, PolynomialTrajectory::X, 3, derivativeOrder);
+    initGroup(yaw, PolynomialTrajectory::YAW, 1, derivativeOrderYaw);
+}
+
+void MinSnapPlanner::initGroup(AxisGroup &group, int firstAxis, int axes,
+    int derivativeOrder)
+{
+    group.firstAxis = firstAxis;
+    group.axes = axes;
+    group.derivativeOrder = derivativeOrder;
+    // Same as trajectory_planner.py: lower order polynomials can only fix
+    // velocity and acceleration at the start and end of the trajectory.
+    if (polyOrder >= 2*derivativeOrder + 1) group.endOrder = derivativeOrder;
+    else group.endOrder = std::min(derivativeOrder, 2);
+    group.patternSegments = 0;
+}
+
+int MinSnapPlanner::constraintCount(const AxisGroup &group,
+    int segments) const
+{
+    // Start and end derivatives, both positions of every segment and
+    // continuity of derivatives at inner keyframes.
+    return 2*(group.endOrder + 1) + 2*(segments - 1) +
+        group.derivativeOrder*(segments - 1);
+}
+
+void MinSnapPlanner::addDerivative(AxisGroup &group, int row, int segment,
+    int k, bool atEnd, double T, double scale)
+{
+    int m = polyOrder + 1;
+    double timeScale = scale*std::pow(T, -k);
+    if (atEnd)
+    {
+        for (int j = k; j < m; j++)
+        {
+            double value = derivativeFactor(k, j)*timeScale;
+            group.triplets.push_back(Triplet(row, segment*m + j, value));
+            group.triplets.push_back(Triplet(segment*m + j, row, value));
+        }
+    }
+    else
+    {
+        double value = derivativeFactor(k, k)*timeScale;
+        group.triplets.push_back(Triplet(row, segment*m + k, value));
+        group.triplets.push_back(Triplet(segment*m + k, row, value));
+    }
+}
+
+void MinSnapPlanner::assemble(AxisGroup &group,
+    const Eigen::MatrixXd &keyframes, const Eigen::VectorXd &T)
+{
+    int segments = int(T.size());
+    int m = polyOrder + 1;
+    int variables = m*segments;
+    int size = variables + constraintCount(group, segments);
+
+    group.triplets.clear();
+    group.rhs.setZero(size, group.axes);
+
+    // Block diagonal cost, 2*Q in the KKT system
+    for (int i = 0; i < segments; i++)
+    {
+        double timeScale = 2.0*std::pow(T(i), 1 - 2*costOrder);
+        for (int j = costOrder; j < m; j++)
+            for (int l = costOrder; l < m; l++)
+                group.triplets.push_back(Triplet(i*m + j, i*m + l,
+                    timeScale*unitCost(j, l)));
+    }
+
+    int row = variables;
+    // Start of the trajectory, position and derivatives
+    for (int k = 0; k <= group.endOrder; k++)
+    {
+        addDerivative(group, row, 0, k, false, T(0), 1.0);
+        if (k == 0)
+            group.rhs.row(row) = keyframes.block(group.firstAxis, 0,
+                group.axes, 1).transpose();
+        row++;
+    }
+
+    for (int i = 0; i < segments; i++)
+    {
+        // Segment end position
+        addDerivative(group, row, i, 0, true, T(i), 1.0);
+        group.rhs.row(row) = keyframes.block(group.firstAxis, i + 1,
+            group.axes, 1).transpose();
+        row++;
+
+        if (i == segments - 1) break;
+
+        // Next segment start position
+        addDerivative(group, row, i + 1, 0, false, T(i + 1), 1.0);
+        group.rhs.row(row) = keyframes.block(group.firstAxis, i + 1,
+            group.axes, 1).transpose();
+        row++;
+
+        // Continuity, rows are scaled to keep entries close to 1
+        for (int k = 1; k <= group.derivativeOrder; k++)
+        {
+            double scale = std::pow(std::min(T(i), T(i + 1)), k);
+            addDerivative(group, row, i, k, true, T(i), scale);
+            addDerivative(group, row, i + 1, k, false, T(i + 1), -scale);
+            row++;
+        }
+    }
+
+    // End of the trajectory, vehicle at rest
+    for (int k = 1; k <= group.endOrder; k++)
+    {
+        addDerivative(group, row, segments - 1, k, true, T(segments - 1), 1.0);
+        row++;
+    }
+
+    group.kkt.resize(size, size);
+    group.kkt.setFromTriplets(group.triplets.begin(), group.triplets.end());
+}
+
+bool MinSnapPlanner::solve(AxisGroup &group, const Eigen::MatrixXd &keyframes,
+    const Eigen::VectorXd &T, PolynomialTrajectory &trajectory)
+{
+    int segments = int(T.size());
+    int m = polyOrder + 1;
+
+    assemble(group, keyframes, T);
+
+    // Sparsity pattern depends only on the number of segments, the fill
+    // reducing ordering is computed once and reused on replanning.
+    if (group.patternSegments != segments)
+    {
+        group.solver.analyzePattern(group.kkt);
+        group.patternSegments = segments;
+    }
+    group.solver.factorize(group.kkt);
+    if (group.solver.info() != Eigen::Success)
+    {
+        group.patternSegments = 0;
+        return false;
+    }
+    group.solution = group.solver.solve(group.rhs);
+    if (group.solver.info() != Eigen::Success) return false;
+
+    for (int a = 0; a < group.axes; a++)
+    {
+        Eigen::MatrixXd &c = trajectory.coefficients[group.firstAxis + a];
+        c.resize(m, segments);
+        for (int i = 0; i < segments; i++)
+        {
+            c.col(i) = group.solution.block(i*m, a, m, 1);
+            cost += std::pow(T(i), 1 - 2*costOrder)*
+                c.col(i).dot(unitCost*c.col(i));
+        }
+    }
+    return true;
+}
+
+bool MinSnapPlanner::plan(const Eigen::MatrixXd &keyframes,
+    const Eigen::VectorXd &T, PolynomialTrajectory &trajectory)
+{
+    if (keyframes.rows() != PolynomialTrajectory::AXES ||
+        keyframes.cols() < 2 || T.size() != keyframes.cols() - 1 ||
+        (T.array() <= 0.0).any())
+        return false;
+
+    cost = 0.0;
+    trajectory.polyOrder = polyOrder;
+    trajectory.T = T;
+    return solve(position, keyframes, T, trajectory) &&
+        solve(yaw, keyframes, T, trajectory);
+}
+
+Eigen::VectorXd MinSnapPlanner::generateT(const Eigen::MatrixXd &keyframes,
+    double nominalSpeed, double minSegmentTime)
+{
+    int segments = int(keyframes.cols()) - 1;
+    Eigen::VectorXd T(std::max(segments, 0));
+    for (int i = 0; i < segments; i++)
+    {
+        double distance = (keyframes.col(i + 1) -
+            keyframes.col(i)).cwiseAbs().maxCoeff();
+        T(i) = std::max(distance/nominalSpeed, minSegmentTime);
+    }
+    return T;
+}
+
+void MinSnapPlanner::unwrapYaw(Eigen::MatrixXd &keyframes)
+{
+    int yawRow = PolynomialTrajectory::YAW;
+    for (int i = 1; i < keyframes.cols(); i++)
+    {
+        double delta = keyframes(yawRow, i) - keyframes(yawRow, i - 1);
+        delta = std::atan2(std::sin(delta), std::cos(delta));
+        keyframes(yawRow, i) = keyframes(yawRow, i - 1) + delta;
+    }
+}
@@ -0,0 +1,177 @@
+/******************************************************************************
+File name: PeriodicExecutor.cpp
+Description: Phase-locked periodic loop for controller nodes.
+******************************************************************************/
+
+#include <mmuav_control/PeriodicExecutor.h>
+
+#include <algorithm>
+#include <limits>
+
+PeriodicExecutor::PeriodicExecutor(ros::NodeHandle &nhParams,
+    ros::NodeHandle &nhTopics, double defaultRate, std::string statisticsTopic)
+{
+    nhParams.param("rate", rate, defaultRate);
+    nhParams.param("statistics_period", statisticsPeriod, double(1.0));
+    nhParams.param("histogram_bins", histogramBins, int(20));
+    nhParams.param("histogram_range", histogramRange, double(0.5));
+
+    if (rate <= 0.0)
+    {
+        ROS_WARN("Invalid loop rate %f, using %f Hz.", rate, defaultRate);
+        rate = defaultRate;
+    }
+    if (histogramBins < 1) histogramBins = 1;
+    if (histogramRange <= 0.0) histogramRange = 0.5;
+    period = 1.0/rate;
+
+    cycle = 0;
+    missedDeadlinesTotal = 0;
+
+    statisticsPub = nhTopics.advertise<mmuav_msgs::LoopStatistics>(
+        statisticsTopic, 1);
+    statisticsMsg.nominal_period = period;
+    statisticsMsg.period_histogram_min = period*(1.0 - histogramRange);
+    statisticsMsg.period_bin_width = 2.0*period*histogramRange/histogramBins;
+    statisticsMsg.jitter_bin_width = period*histogramRange/histogramBins;
+}
+
+bool PeriodicExecutor::waitForClock()
+{
+    // Replaces busy waiting on rospy.get_time() == 0, sleeps in wall time
+    // until the first clock message arrives.
+    while (ros::ok())
+    {
+        if (ros::Time::waitForValid(ros::WallDuration(1.0)))
+            return true;
+        ROS_INFO("Waiting for clock server to start.");
+    }
+    return false;
+}
+
+void PeriodicExecutor::spin(const ControlLaw &controlLaw,
+    bool processCallbacks)
+{
+    if (!waitForClock()) return;
+
+    startTime = ros::Time::now();
+    ros::Time lastWakeup = startTime;
+    cycle = 0;
+    resetStatistics(startTime);
+    ROS_INFO("Periodic executor running at %.1f Hz.", rate);
+
+    while (ros::ok())
+    {
+        cycle++;
+        ros::Time deadline = startTime + ros::Duration(double(cycle)*period);
+        // With sim time sleepUntil also returns false when the clock jumps
+        // backwards, only shutdown ends the loop.
+        bool slept = ros::Time::sleepUntil(deadline);
+        if (!ros::ok()) break;
+        ros::Time now = ros::Time::now();
+
+        // Simulation was reset, clock went backwards. Restart the schedule.
+        if (!slept || now < lastWakeup)
+        {
+            ROS_WARN("Clock jumped backwards, restarting loop schedule.");
+            startTime = now;
+            lastWakeup = now;
+            cycle = 0;
+            resetStatistics(now);
+            continue;
+        }
+
+        // If an iteration overran by more than a period the missed deadlines
+        // are skipped. Schedule stays phase-locked to startTime instead of
+        // catching up with a burst of short periods.
+        double jitter = (now - deadline).toSec();
+        if (jitter >= period)
+        {
+            unsigned long long skipped = (unsigned long long)(jitter/period);
+            cycle += skipped;
+            windowMissed += skipped;
+            missedDeadlinesTotal += skipped;
+            deadline = startTime + ros::Duration(double(cycle)*period);
+            jitter = (now - deadline).toSec();
+        }
+
+        double dt = (now - lastWakeup).toSec();
+        lastWakeup = now;
+
+        if (processCallbacks) ros::spinOnce();
+
+        if (dt > 0.0)
+        {
+            recordIteration(dt, jitter);
+            controlLaw(now, dt);
+        }
+
+        if ((now - windowStart).toSec() >= statisticsPeriod)
+            publishStatistics(now);
+    }
+}
+
+void PeriodicExecutor::resetStatistics(const ros::Time &now)
+{
+    windowStart = now;
+    periodSum = 0.0;
+    jitterSum = 0.0;
+    minPeriod = std::numeric_limits<double>::max();
+    maxPeriod = 0.0;
+    maxJitter = 0.0;
+    windowIterations = 0;
+    windowMissed = 0;
+    statisticsMsg.period_histogram.assign(histogramBins, 0);
+    statisticsMsg.jitter_histogram.assign(histogramBins, 0);
+}
+
+void PeriodicExecutor::recordIteration(double measuredPeriod, double jitter)
+{
+    windowIterations++;
+    periodSum += measuredPeriod;
+    jitterSum += jitter;
+    minPeriod = std::min(minPeriod, measuredPeriod);
+    maxPeriod = std::max(maxPeriod, measuredPeriod);
+    maxJitter = std::max(maxJitter, jitter);
+
+    addToHistogram(statisticsMsg.period_histogram, measuredPeriod,
+        statisticsMsg.period_histogram_min, statisticsMsg.period_bin_width);
+    addToHistogram(statisticsMsg.jitter_histogram, jitter, 0.0,
+        statisticsMsg.jitter_bin_width);
+}
+
+void PeriodicExecutor::publishStatistics(const ros::Time &now)
+{
+    double window = (now - windowStart).toSec();
+
+    statisticsMsg.header.stamp = now;
+    statisticsMsg.iterations = windowIterations;
+    statisticsMsg.missed_deadlines = windowMissed;
+    if (windowIterations > 0)
+    {
+        statisticsMsg.mean_period = periodSum/windowIterations;
+        statisticsMsg.mean_jitter = jitterSum/windowIterations;
+        statisticsMsg.min_period = minPeriod;
+    }
+    else
+    {
+        statisticsMsg.mean_period = 0.0;
+        statisticsMsg.mean_jitter = 0.0;
+        statisticsMsg.min_period = 0.0;
+    }
+    statisticsMsg.max_period = maxPeriod;
+    statisticsMsg.max_jitter = maxJitter;
+    statisticsMsg.achieved_rate = window > 0.0 ? windowIterations/window : 0.0;
+    statisticsPub.publish(statisticsMsg);
+
+    resetStatistics(now);
+}
+
+void PeriodicExecutor::addToHistogram(std::vector<unsigned int> &histogram,
+    double value, double minValue, double binWidth)
+{
+    int bin = int((value - minValue)/binWidth);
+    if (bin < 0) bin = 0;
+    else if (bin >= int(histogram.size())) bin = int(histogram.size()) - 1;
+    histogram[bin]++;
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+File name: PolynomialTrajectorySampler.cpp
+Description: Evaluates position, velocity and acceleration of a piecewise
+    polynomial trajectory on demand.
+******************************************************************************/
+
+#include <mmuav_control/PolynomialTrajectorySampler.h>
+
+#include <cmath>
+#include <algorithm>
+
+PolynomialTrajectorySampler::PolynomialTrajectorySampler() :
+    polyOrder(0), lastSegment(0)
+{
+}
+
+void PolynomialTrajectorySampler::setTrajectory(
+    const PolynomialTrajectory &trajectory)
+{
+    int segments = trajectory.segments();
+    int m = trajectory.polyOrder + 1;
+
+    polyOrder = trajectory.polyOrder;
+    segmentStart.resize(segments);
+    segmentTime.resize(segments);
+    coefficients.resize(segments*m);
+    lastSegment = 0;
+
+    double start = 0.0;
+    for (int i = 0; i < segments; i++)
+    {
+        segmentStart[i] = start;
+        segmentTime[i] = trajectory.T(i);
+        start += trajectory.T(i);
+        for (int j = 0; j < m; j++)
+        {
+            for (int axis = 0; axis < PolynomialTrajectory::AXES; axis++)
+                coefficients[i*m + j](axis) =
+                    trajectory.coefficients[axis](j, i);
+        }
+    }
+}
+
+double PolynomialTrajectorySampler::duration() const
+{
+    if (empty()) return 0.0;
+    return segmentStart.back() + segmentTime.back();
+}
+
+void PolynomialTrajectorySampler::sample(double t, Sample &result) const
+{
+    result.position.setZero();
+    result.velocity.setZero();
+    result.acceleration.setZero();
+    if (empty()) return;
+
+    // Streaming access moves forward one segment at a time, random access
+    // falls back to binary search.
+    size_t segment = lastSegment;
+    if (t < segmentStart[segment])
+    {
+        segment = std::upper_bound(segmentStart.begin(), segmentStart.end(), t)
+            - segmentStart.begin();
+        if (segment > 0) segment--;
+    }
+    while (segment + 1 < segmentStart.size() && t >= segmentStart[segment + 1])
+        segment++;
+    lastSegment = segment;
+
+    double T = segmentTime[segment];
+    double tau = (t - segmentStart[segment])/T;
+    tau = std::min(std::max(tau, 0.0), 1.0);
+
+    // Horner scheme for the polynomial and its first two derivatives,
+    // all axes at once.
+    const Eigen::Array4d *c = &coefficients[segment*(polyOrder + 1)];
+    Eigen::Array4d p = c[polyOrder];
+    Eigen::Array4d v = Eigen::Array4d::Zero();
+    Eigen::Array4d a = Eigen::Array4d::Zero();
+    for (int j = polyOrder - 1; j >= 0; j--)
+    {
+        a = a*tau + 2.0*v;
+        v = v*tau + p;
+        p = p*tau + c[j];
+    }
+
+    result.position = p;
+    result.velocity = v/T;
+    result.acceleration = a/(T*T);
+}
+
+void PolynomialTrajectorySampler::toMsg(const PolynomialTrajectory &trajectory,
+    mmuav_msgs::PolynomialTrajectory &msg)
+{
+    int segments = trajectory.segments();
+    int m = trajectory.polyOrder + 1;
+    std::vector<double> *axes[PolynomialTrajectory::AXES] =
+        {&msg.x, &msg.y, &msg.z, &msg.yaw};
+
+    msg.poly_order = trajectory.polyOrder;
+    msg.segment_times.assign(trajectory.T.data(),
+        trajectory.T.data() + segments);
+    for (int axis = 0; axis < PolynomialTrajectory::AXES; axis++)
+    {
+        // Column major, coefficients of a segment are contiguous
+        const Eigen::MatrixXd &c = trajectory.coefficients[axis];
+        axes[axis]->assign(c.data(), c.data() + m*segments);
+    }
+}
+
+bool PolynomialTrajectorySampler::fromMsg(
+    const mmuav_msgs::PolynomialTrajectory &msg,
+    PolynomialTrajectory &trajectory)
+{
+    int segments = int(msg.segment_times.size());
+    int m = int(msg.poly_order) + 1;
+    const std::vector<double> *axes[PolynomialTrajectory::AXES] =
+        {&msg.x, &msg.y, &msg.z, &msg.yaw};
+
+    for (int axis = 0; axis < PolynomialTrajectory::AXES; axis++)
+        if (int(axes[axis]->size()) != m*segments) return false;
+    for (int i = 0; i < segments; i++)
+        if (!(msg.segment_times[i] > 0.0)) return false;
+
+    trajectory.polyOrder = msg.poly_order;
+    trajectory.T = Eigen::Map<const Eigen::VectorXd>(
+        msg.segment_times.data(), segments);
+    for (int axis = 0; axis < PolynomialTrajectory::AXES; axis++)
+        trajectory.coefficients[axis] = Eigen::Map<const Eigen::MatrixXd>(
+            axes[axis]->data(), m, segments);
+    return true;
+}
+
+void PolynomialTrajectorySampler::toPointMsg(const Sample &sample, double t,
+    trajectory_msgs::MultiDOFJointTrajectoryPoint &point)
+{
+    point.transforms.resize(1);
+    point.velocities.resize(1);
+    point.accelerations.resize(1);
+    point.transforms[0].translation.x = sample.position(0);
+    point.transforms[0].translation.y = sample.position(1);
+    point.transforms[0].translation.z = sample.position(2);
+    point.transforms[0].rotation.x = 0.0;
+    point.transforms[0].rotation.y = 0.0;
+    point.transforms[0].rotation.z = sin(sample.position(3)/2.0);
+    point.transforms[0].rotation.w = cos(sample.position(3)/2.0);
+    point.velocities[0].linear.x = sample.velocity(0);
+    point.velocities[0].linear.y = sample.velocity(1);
+    point.velocities[0].linear.z = sample.velocity(2);
+    point.velocities[0].angular.x = 0.0;
+    point.velocities[0].angular.y = 0.0;
+    point.velocities[0].angular.z = sample.velocity(3);
+    point.accelerations[0].linear.x = sample.acceleration(0);
+    point.accelerations[0].linear.y = sample.acceleration(1);
+    point.accelerations[0].linear.z = sample.acceleration(2);
+    point.accelerations[0].angular.x = 0.0;
+    point.accelerations[0].angular.y = 0.0;
+    point.accelerations[0].angular.z = sample.acceleration(3);
+    point.time_from_start = ros::Duration(t);
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+File name: SegmentTimeOptimizer.cpp
+Description: Gradient based segment time refinement for MinSnapPlanner.
+******************************************************************************/
+
+#include <mmuav_control/SegmentTimeOptimizer.h>
+
+#include <chrono>
+#include <limits>
+#include <boost/bind.hpp>
+
+SegmentTimeOptimizer::SegmentTimeOptimizer(int polyOrder, int derivativeOrder,
+    int derivativeOrderYaw, int threads) :
+    maxIterations(20), timeBudget(0.05), minSegmentTime(0.1),
+    iterations(0), initialCost(0.0), cost(0.0), pool(threads)
+{
+    for (int i = 0; i < pool.size(); i++)
+    {
+        planners.push_back(std::unique_ptr<MinSnapPlanner>(new MinSnapPlanner(
+            polyOrder, derivativeOrder, derivativeOrderYaw)));
+    }
+    scratch.resize(pool.size());
+}
+
+void SegmentTimeOptimizer::perturbationTask(int worker, int index,
+    const Eigen::MatrixXd *keyframes, const Eigen::VectorXd *T, double step)
+{
+    // Forward difference of the cost w.r.t. duration of segment index
+    Eigen::VectorXd perturbed = *T;
+    perturbed(index) += step*(*T)(index);
+    if (planners[worker]->plan(*keyframes, perturbed, scratch[worker]))
+        gradient(index) = (planners[worker]->getCost() - cost)/
+            (step*(*T)(index));
+    else
+        gradient(index) = 0.0;
+}
+
+void SegmentTimeOptimizer::candidateTask(int worker, int index,
+    const Eigen::MatrixXd *keyframes)
+{
+    if (planners[worker]->plan(*keyframes, candidates[index], scratch[worker]))
+        candidateCosts(index) = planners[worker]->getCost();
+    else
+        candidateCosts(index) = std::numeric_limits<double>::infinity();
+}
+
+bool SegmentTimeOptimizer::optimize(const Eigen::MatrixXd &keyframes,
+    Eigen::VectorXd &T, PolynomialTrajectory &trajectory)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() +
+        std::chrono::microseconds(long(timeBudget*1e6));
+
+    iterations = 0;
+    if (!planners[0]->plan(keyframes, T, trajectory)) return false;
+    initialCost = cost = planners[0]->getCost();
+
+    int segments = int(T.size());
+    // A single segment has nothing to redistribute
+    if (segments < 2) return true;
+
+    const double step = 1e-4;
+    int lineSearchSteps = std::max(pool.size(), 4);
+    candidates.resize(lineSearchSteps);
+    candidateCosts.resize(lineSearchSteps);
+    gradient.resize(segments);
+
+    while (iterations < maxIterations && Clock::now() < deadline)
+    {
+        // One perturbed solve per segment, all independent
+        pool.parallelFor(segments, boost::bind(
+            &SegmentTimeOptimizer::perturbationTask, this, _1, _2,
+            &keyframes, &T, step));
+
+        // Descent direction projected onto sum(T) = const
+        Eigen::VectorXd direction = -(gradient.array() - gradient.mean()).matrix();
+        if (direction.cwiseAbs().maxCoeff() <= 0.0) break;
+
+        // Largest step keeping every segment above half of its current
+        // duration and above the minimum segment time
+        double maxStep = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < segments; i++)
+        {
+            if (direction(i) >= 0.0) continue;
+            double lowest = std::max(minSegmentTime, 0.5*T(i));
+            maxStep = std::min(maxStep, (T(i) - lowest)/(-direction(i)));
+        }
+        if (!(maxStep > 0.0) || maxStep == std::numeric_limits<double>::infinity())
+            break;
+
+        // Line search, candidate steps are evaluated in parallel
+        for (int k = 0; k < lineSearchSteps; k++)
+            candidates[k] = T + maxStep*std::pow(0.5, k)*direction;
+        pool.parallelFor(lineSearchSteps, boost::bind(
+            &SegmentTimeOptimizer::candidateTask, this, _1, _2, &keyframes));
+
+        int best;
+        double bestCost = candidateCosts.minCoeff(&best);
+        iterations++;
+        if (!(bestCost < cost)) break;
+        T = candidates[best];
+        cost = bestCost;
+    }
+
+    // Final plan with the refined times
+    if (!planners[0]->plan(keyframes, T, trajectory)) return false;
+    cost = planners[0]->getCost();
+    return true;
+}
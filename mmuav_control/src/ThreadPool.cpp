@@ -0,0 +1,63 @@
+/******************************************************************************
+File name: ThreadPool.cpp
+Description: Fixed size pool of worker threads running parallel for loops.
+******************************************************************************/
+
+#include <mmuav_control/ThreadPool.h>
+
+ThreadPool::ThreadPool(int threads) :
+    nextIndex(0), taskCount(0), activeWorkers(0), generation(0),
+    stopping(false)
+{
+    if (threads <= 0) threads = int(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+    for (int i = 0; i < threads; i++)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+void ThreadPool::parallelFor(int count,
+    const boost::function<void(int worker, int index)> &task)
+{
+    if (count <= 0) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    currentTask = task;
+    taskCount = count;
+    nextIndex = 0;
+    activeWorkers = int(workers.size());
+    generation++;
+    wakeCondition.notify_all();
+    doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+    currentTask.clear();
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+    unsigned long seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wakeCondition.wait(lock, [this, seenGeneration]
+            { return stopping || generation != seenGeneration; });
+        if (stopping) return;
+        seenGeneration = generation;
+        int count = taskCount;
+        lock.unlock();
+
+        int index;
+        while ((index = nextIndex++) < count) currentTask(worker, index);
+
+        lock.lock();
+        if (--activeWorkers == 0) doneCondition.notify_all();
+    }
+}
@@ -0,0 +1,154 @@
+/******************************************************************************
+File name: TrajectoryCache.cpp
+Description: LRU cache of planned trajectories.
+******************************************************************************/
+
+#include <mmuav_control/TrajectoryCache.h>
+
+#include <cmath>
+#include <boost/functional/hash.hpp>
+
+TrajectoryCache::TrajectoryCache(size_t capacity, double tolerance) :
+    capacity(capacity), tolerance(tolerance), hits(0), misses(0)
+{
+    if (!(this->tolerance > 0.0)) this->tolerance = 1e-4;
+}
+
+TrajectoryCache::Frame TrajectoryCache::frameOf(const Eigen::MatrixXd &keyframes)
+{
+    Frame frame;
+    frame.origin = keyframes.block<3, 1>(0, 0);
+    frame.yaw = keyframes(PolynomialTrajectory::YAW, 0);
+    return frame;
+}
+
+Eigen::MatrixXd TrajectoryCache::normalize(const Eigen::MatrixXd &keyframes)
+{
+    Eigen::MatrixXd normalized(keyframes.rows(), keyframes.cols());
+    if (keyframes.cols() == 0) return normalized;
+
+    Frame frame = frameOf(keyframes);
+    double c = cos(frame.yaw), s = sin(frame.yaw);
+    for (int i = 0; i < keyframes.cols(); i++)
+    {
+        double dx = keyframes(0, i) - frame.origin(0);
+        double dy = keyframes(1, i) - frame.origin(1);
+        normalized(0, i) = c*dx + s*dy;
+        normalized(1, i) = -s*dx + c*dy;
+        normalized(2, i) = keyframes(2, i) - frame.origin(2);
+        normalized(PolynomialTrajectory::YAW, i) =
+            keyframes(PolynomialTrajectory::YAW, i) - frame.yaw;
+    }
+    return normalized;
+}
+
+TrajectoryCache::Key TrajectoryCache::makeKey(const Eigen::MatrixXd &keyframes,
+    const Eigen::VectorXd &T, int polyOrder) const
+{
+    Eigen::MatrixXd normalized = normalize(keyframes);
+    Key key;
+    key.reserve(2 + 4*keyframes.cols() + T.size());
+    key.push_back(polyOrder);
+    key.push_back(keyframes.cols());
+    for (int i = 0; i < normalized.cols(); i++)
+        for (int j = 0; j < 4; j++)
+            key.push_back((long long)(llround(normalized(j, i)/tolerance)));
+    for (int i = 0; i < T.size(); i++)
+        key.push_back((long long)(llround(T(i)/tolerance)));
+    return key;
+}
+
+size_t TrajectoryCache::hashKey(const Key &key)
+{
+    return boost::hash_range(key.begin(), key.end());
+}
+
+void TrajectoryCache::transform(PolynomialTrajectory &trajectory,
+    const Frame &frame, int direction)
+{
+    double c = cos(frame.yaw), s = sin(direction > 0 ? frame.yaw : -frame.yaw);
+    Eigen::MatrixXd &x = trajectory.coefficients[PolynomialTrajectory::X];
+    Eigen::MatrixXd &y = trajectory.coefficients[PolynomialTrajectory::Y];
+    Eigen::MatrixXd &z = trajectory.coefficients[PolynomialTrajectory::Z];
+    Eigen::MatrixXd &yaw = trajectory.coefficients[PolynomialTrajectory::YAW];
+
+    // Translation only moves the constant coefficient of every segment,
+    // rotation applies to all coefficients.
+    if (direction < 0)
+    {
+        x.row(0).array() -= frame.origin(0);
+        y.row(0).array() -= frame.origin(1);
+        z.row(0).array() -= frame.origin(2);
+        yaw.row(0).array() -= frame.yaw;
+    }
+    Eigen::MatrixXd rotatedX = c*x - s*y;
+    y = s*x + c*y;
+    x = rotatedX;
+    if (direction > 0)
+    {
+        x.row(0).array() += frame.origin(0);
+        y.row(0).array() += frame.origin(1);
+        z.row(0).array() += frame.origin(2);
+        yaw.row(0).array() += frame.yaw;
+    }
+}
+
+bool TrajectoryCache::lookup(const Eigen::MatrixXd &keyframes,
+    const Eigen::VectorXd &T, int polyOrder, PolynomialTrajectory &trajectory)
+{
+    if (capacity == 0 || keyframes.cols() == 0) return false;
+
+    Frame frame = frameOf(keyframes);
+    Key key = makeKey(keyframes, T, polyOrder);
+    std::unordered_map<size_t, std::list<Entry>::iterator>::iterator it =
+        index.find(hashKey(key));
+    if (it == index.end() || it->second->key != key)
+    {
+        misses++;
+        return false;
+    }
+
+    // Move to front, most recently used
+    entries.splice(entries.begin(), entries, it->second);
+    trajectory = entries.front().trajectory;
+    transform(trajectory, frame, 1);
+    hits++;
+    return true;
+}
+
+void TrajectoryCache::insert(const Eigen::MatrixXd &keyframes,
+    const Eigen::VectorXd &T, int polyOrder,
+    const PolynomialTrajectory &trajectory)
+{
+    if (capacity == 0 || keyframes.cols() == 0) return;
+
+    Frame frame = frameOf(keyframes);
+    Entry entry;
+    entry.key = makeKey(keyframes, T, polyOrder);
+    entry.hash = hashKey(entry.key);
+    entry.trajectory = trajectory;
+    transform(entry.trajectory, frame, -1);
+
+    // Replaces an entry with the same hash, including hash collisions
+    std::unordered_map<size_t, std::list<Entry>::iterator>::iterator it =
+        index.find(entry.hash);
+    if (it != index.end())
+    {
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    entries.push_front(entry);
+    index[entry.hash] = entries.begin();
+    while (entries.size() > capacity)
+    {
+        index.erase(entries.back().hash);
+        entries.pop_back();
+    }
+}
+
+void TrajectoryCache::clear()
+{
+    entries.clear();
+    index.clear();
+}
@@ -0,0 +1,167 @@
+/******************************************************************************
+File name: TrajectoryPlanner.cpp
+Description: ROS node planning minimum snap trajectories through keyframes
+    received on multi_dof_trajectory.
+******************************************************************************/
+
+#include <mmuav_control/TrajectoryPlanner.h>
+
+#include <cmath>
+#include <algorithm>
+
+TrajectoryPlanner::TrajectoryPlanner()
+{
+    int polyOrder, derivativeOrder, derivativeOrderYaw;
+    nhParams = ros::NodeHandle("~");
+    nhParams.param("poly_order", polyOrder, int(9));
+    nhParams.param("derivative_order", derivativeOrder, int(4));
+    nhParams.param("derivative_order_yaw", derivativeOrderYaw, int(2));
+    // Segment time is the largest per-axis keyframe distance divided by
+    // nominal speed.
+    nhParams.param("nominal_speed", nominalSpeed, double(1.0));
+    nhParams.param("min_segment_time", minSegmentTime, double(0.1));
+    // Sampled trajectory is published for trajectory_to_trajectory_point.py,
+    // polynomial trajectory is always published.
+    nhParams.param("publish_sampled_trajectory", publishSampled, true);
+    // Sampling rate of the published trajectory
+    nhParams.param("rate", rate, double(100.0));
+
+    if (2*derivativeOrder + 2 > polyOrder + 1)
+    {
+        ROS_WARN("Polynomial order %d too low for derivative order %d.",
+            polyOrder, derivativeOrder);
+        derivativeOrder = (polyOrder - 1)/2;
+    }
+    planner.reset(new MinSnapPlanner(polyOrder, derivativeOrder,
+        derivativeOrderYaw));
+
+    // Segment time refinement, disabled by default
+    bool optimizeTimes;
+    int iterations, threads;
+    double timeBudget;
+    nhParams.param("optimize_segment_times", optimizeTimes, false);
+    nhParams.param("time_optimization_iterations", iterations, int(20));
+    nhParams.param("time_optimization_budget", timeBudget, double(0.05));
+    nhParams.param("time_optimization_threads", threads, int(0));
+    if (optimizeTimes)
+    {
+        timeOptimizer.reset(new SegmentTimeOptimizer(polyOrder,
+            derivativeOrder, derivativeOrderYaw, threads));
+        timeOptimizer->setMaxIterations(iterations);
+        timeOptimizer->setTimeBudget(timeBudget);
+        timeOptimizer->setMinSegmentTime(minSegmentTime);
+    }
+
+    // Planned trajectories are cached, repeated or moved keyframe sets are
+    // not replanned.
+    int cacheSize;
+    double cacheTolerance;
+    nhParams.param("cache_size", cacheSize, int(32));
+    nhParams.param("cache_tolerance", cacheTolerance, double(1e-4));
+    cache.reset(new TrajectoryCache(std::max(cacheSize, 0), cacheTolerance));
+
+    keyframes_sub = nhTopics.subscribe("multi_dof_trajectory", 1,
+        &TrajectoryPlanner::keyframesCallback, this);
+    trajectory_pub = nhTopics.advertise<trajectory_msgs::MultiDOFJointTrajectory>(
+        "planned_trajectory", 1);
+    polynomial_trajectory_pub =
+        nhTopics.advertise<mmuav_msgs::PolynomialTrajectory>(
+        "polynomial_trajectory", 1);
+}
+
+void TrajectoryPlanner::run()
+{
+    ros::spin();
+}
+
+void TrajectoryPlanner::keyframesCallback(
+    const trajectory_msgs::MultiDOFJointTrajectory &msg)
+{
+    int keyframeCount = 0;
+    Eigen::MatrixXd keyframes(PolynomialTrajectory::AXES, msg.points.size());
+    for (size_t i = 0; i < msg.points.size(); i++)
+    {
+        if (msg.points[i].transforms.size() == 0) continue;
+        const geometry_msgs::Transform &transform = msg.points[i].transforms[0];
+        const geometry_msgs::Quaternion &q = transform.rotation;
+        keyframes(0, keyframeCount) = transform.translation.x;
+        keyframes(1, keyframeCount) = transform.translation.y;
+        keyframes(2, keyframeCount) = transform.translation.z;
+        keyframes(3, keyframeCount) = atan2(2.0*(q.w*q.z + q.x*q.y),
+            1.0 - 2.0*(q.y*q.y + q.z*q.z));
+        keyframeCount++;
+    }
+    if (keyframeCount < 2)
+    {
+        ROS_WARN("At least two keyframes are needed, received %d.",
+            keyframeCount);
+        return;
+    }
+    keyframes.conservativeResize(Eigen::NoChange, keyframeCount);
+    MinSnapPlanner::unwrapYaw(keyframes);
+
+    ros::WallTime startTime = ros::WallTime::now();
+    // Segment times from the per-axis distances in the frame of the first
+    // keyframe, so they do not change with the heading of the request.
+    Eigen::VectorXd T = MinSnapPlanner::generateT(
+        TrajectoryCache::normalize(keyframes), nominalSpeed, minSegmentTime);
+    if (cache->lookup(keyframes, T, planner->getPolyOrder(), trajectory))
+    {
+        ROS_INFO("Trajectory with %d segments found in cache (%lu hits, "
+            "%lu misses).", trajectory.segments(), cache->getHits(),
+            cache->getMisses());
+    }
+    else
+    {
+        bool planned;
+        Eigen::VectorXd initialT = T;
+        if (timeOptimizer)
+            planned = timeOptimizer->optimize(keyframes, T, trajectory);
+        else planned = planner->plan(keyframes, T, trajectory);
+        if (!planned)
+        {
+            ROS_ERROR("Trajectory planning failed for %d keyframes.",
+                keyframeCount);
+            return;
+        }
+        cache->insert(keyframes, initialT, planner->getPolyOrder(), trajectory);
+        if (timeOptimizer)
+        {
+            ROS_INFO("Segment time optimization: %d iterations, cost %f -> %f.",
+                timeOptimizer->getIterations(), timeOptimizer->getInitialCost(),
+                timeOptimizer->getCost());
+        }
+    }
+    double planningTime = (ros::WallTime::now() - startTime).toSec();
+    ROS_INFO("Planned %d segments in %.3f ms, duration %.2f s.",
+        trajectory.segments(), 1000.0*planningTime, trajectory.duration());
+
+    PolynomialTrajectorySampler::toMsg(trajectory, polynomialTrajectoryMsg);
+    polynomialTrajectoryMsg.header.stamp = ros::Time::now();
+    polynomialTrajectoryMsg.header.frame_id = msg.header.frame_id;
+    polynomial_trajectory_pub.publish(polynomialTrajectoryMsg);
+
+    if (publishSampled)
+    {
+        sampleTrajectory(trajectory, rate, trajectoryMsg);
+        trajectoryMsg.header = polynomialTrajectoryMsg.header;
+        trajectory_pub.publish(trajectoryMsg);
+    }
+}
+
+void TrajectoryPlanner::sampleTrajectory(const PolynomialTrajectory &trajectory,
+    double rate, trajectory_msgs::MultiDOFJointTrajectory &msg)
+{
+    PolynomialTrajectorySampler sampler;
+    PolynomialTrajectorySampler::Sample sample;
+    sampler.setTrajectory(trajectory);
+
+    int samples = int(floor(trajectory.duration()*rate)) + 1;
+    msg.points.resize(samples);
+    for (int i = 0; i < samples; i++)
+    {
+        double t = double(i)/rate;
+        sampler.sample(t, sample);
+        PolynomialTrajectorySampler::toPointMsg(sample, t, msg.points[i]);
+    }
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+File name: loopRateBenchmarkNode.cpp
+Description: Runs a PeriodicExecutor loop with synthetic computational and
+    callback load. Used to verify a controller rate (e.g. 200 Hz) holds under
+    load, results are on the loop_statistics topic.
+******************************************************************************/
+
+#include <mmuav_control/PeriodicExecutor.h>
+
+#include <std_msgs/Float64.h>
+#include <boost/bind.hpp>
+#include <cstdlib>
+
+class LoopRateBenchmark
+{
+public:
+    LoopRateBenchmark() : sink(0.0), received(0)
+    {
+        nhParams = ros::NodeHandle("~");
+        // Busy time of the control law, as a fraction of the loop period
+        nhParams.param("load", load, double(0.5));
+        // Random additional busy time, as a fraction of the loop period
+        nhParams.param("load_jitter", loadJitter, double(0.1));
+        // Rate of the dummy topic loading the callback queue
+        nhParams.param("callback_rate", callbackRate, double(1000.0));
+
+        dummyPub = nhTopics.advertise<std_msgs::Float64>("benchmark_load", 1);
+        dummySub = nhTopics.subscribe("benchmark_load", 100,
+            &LoopRateBenchmark::dummyCallback, this);
+        if (callbackRate > 0.0)
+        {
+            dummyTimer = nhTopics.createWallTimer(
+                ros::WallDuration(1.0/callbackRate),
+                &LoopRateBenchmark::dummyTimerCallback, this);
+        }
+    }
+
+    void run()
+    {
+        PeriodicExecutor executor(nhParams, nhTopics, 200.0);
+        period = executor.getPeriod();
+        // Dummy topic is served by a separate thread so it competes with
+        // the control loop the same way a busy node would.
+        ros::AsyncSpinner spinner(1);
+        spinner.start();
+        executor.spin(boost::bind(&LoopRateBenchmark::controlLaw, this, _1, _2),
+            false);
+    }
+
+private:
+    ros::NodeHandle nhParams, nhTopics;
+    ros::Publisher dummyPub;
+    ros::Subscriber dummySub;
+    ros::WallTimer dummyTimer;
+    double load, loadJitter, callbackRate, period;
+    double sink;
+    unsigned long received;
+
+    void controlLaw(const ros::Time &now, double dt)
+    {
+        double busy = period*(load + loadJitter*double(rand())/RAND_MAX);
+        ros::WallTime end = ros::WallTime::now() + ros::WallDuration(busy);
+        while (ros::WallTime::now() < end) sink += dt;
+    }
+
+    void dummyTimerCallback(const ros::WallTimerEvent &event)
+    {
+        std_msgs::Float64 msg;
+        msg.data = double(received);
+        dummyPub.publish(msg);
+    }
+
+    void dummyCallback(const std_msgs::Float64 &msg)
+    {
+        received++;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "loopRateBenchmarkNode");
+    LoopRateBenchmark benchmark;
+    benchmark.run();
+    return 0;
+}
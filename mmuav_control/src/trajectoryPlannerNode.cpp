@@ -0,0 +1,14 @@
+/******************************************************************************
+File name: trajectoryPlannerNode.cpp
+Description: Minimum snap trajectory planner node.
+******************************************************************************/
+
+#include <mmuav_control/TrajectoryPlanner.h>
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "trajectory_planner");
+    TrajectoryPlanner trajectoryPlanner;
+    trajectoryPlanner.run();
+    return 0;
+}
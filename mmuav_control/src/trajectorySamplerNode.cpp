@@ -0,0 +1,133 @@
+/******************************************************************************
+File name: trajectorySamplerNode.cpp
+Description: Streams trajectory_point_ref from a polynomial trajectory.
+    Replacement for trajectory_to_trajectory_point.py that receives segment
+    coefficients instead of a pre-sampled trajectory and evaluates the
+    reference at loop time.
+******************************************************************************/
+
+#include <mmuav_control/PeriodicExecutor.h>
+#include <mmuav_control/PolynomialTrajectorySampler.h>
+
+#include <cmath>
+#include <std_msgs/Empty.h>
+#include <std_msgs/Int32.h>
+#include <boost/bind.hpp>
+
+class TrajectorySampler
+{
+public:
+    TrajectorySampler() : executing(false), startPending(false)
+    {
+        nhParams = ros::NodeHandle("~");
+        nhParams.param("trajectory_type", trajectoryType, int(0));
+        // Time window repeated when trajectory_type is 1 (endless)
+        nhParams.param("split_start", splitStart, double(5.21));
+        nhParams.param("split_end", splitEnd, double(9.59));
+
+        trajectory_point_pub =
+            nhTopics.advertise<trajectory_msgs::MultiDOFJointTrajectoryPoint>(
+            "trajectory_point_ref", 1);
+        executing_trajectory_pub = nhTopics.advertise<std_msgs::Int32>(
+            "executing_trajectory", 1);
+        trajectory_sub = nhTopics.subscribe("polynomial_trajectory", 1,
+            &TrajectorySampler::trajectoryCallback, this);
+        stop_sub = nhTopics.subscribe("stop_trajectory_execution", 1,
+            &TrajectorySampler::stopCallback, this);
+        trajectory_type_sub = nhTopics.subscribe("trajectory_type", 1,
+            &TrajectorySampler::trajectoryTypeCallback, this);
+    }
+
+    void run()
+    {
+        PeriodicExecutor executor(nhParams, nhTopics, 100.0);
+        executor.spin(boost::bind(&TrajectorySampler::update, this, _1, _2));
+    }
+
+private:
+    ros::NodeHandle nhParams, nhTopics;
+    ros::Publisher trajectory_point_pub, executing_trajectory_pub;
+    ros::Subscriber trajectory_sub, stop_sub, trajectory_type_sub;
+
+    PolynomialTrajectorySampler sampler;
+    PolynomialTrajectorySampler::Sample sample;
+    trajectory_msgs::MultiDOFJointTrajectoryPoint pointMsg;
+    std_msgs::Int32 executingMsg;
+
+    int trajectoryType;
+    double splitStart, splitEnd;
+    bool executing, startPending;
+    ros::Time startTime;
+
+    void update(const ros::Time &now, double dt)
+    {
+        // Trajectory starts on the first loop iteration after it arrived
+        if (startPending)
+        {
+            startTime = now;
+            startPending = false;
+        }
+
+        executingMsg.data = executing ? 1 : 0;
+        executing_trajectory_pub.publish(executingMsg);
+        if (!executing) return;
+
+        double t = (now - startTime).toSec();
+        double duration = sampler.duration();
+        double windowStart = std::min(std::max(splitStart, 0.0), duration);
+        double windowEnd = std::min(std::max(splitEnd, windowStart), duration);
+
+        if (trajectoryType == 1 && windowEnd > windowStart)
+        {
+            t = windowStart + fmod(t, windowEnd - windowStart);
+        }
+        else if (t >= duration)
+        {
+            t = duration;
+            executing = false;
+        }
+
+        sampler.sample(t, sample);
+        PolynomialTrajectorySampler::toPointMsg(sample, t, pointMsg);
+        trajectory_point_pub.publish(pointMsg);
+    }
+
+    void trajectoryCallback(const mmuav_msgs::PolynomialTrajectory &msg)
+    {
+        ROS_INFO("Received a trajectory.");
+        if (executing)
+        {
+            ROS_INFO("Currently executing a trajectory.");
+            return;
+        }
+
+        PolynomialTrajectory trajectory;
+        if (!PolynomialTrajectorySampler::fromMsg(msg, trajectory) ||
+            trajectory.segments() == 0)
+        {
+            ROS_WARN("Invalid polynomial trajectory, ignoring it.");
+            return;
+        }
+        sampler.setTrajectory(trajectory);
+        executing = true;
+        startPending = true;
+    }
+
+    void stopCallback(const std_msgs::Empty &msg)
+    {
+        executing = false;
+    }
+
+    void trajectoryTypeCallback(const std_msgs::Int32 &msg)
+    {
+        trajectoryType = msg.data;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "trajectory_sampler");
+    TrajectorySampler trajectorySampler;
+    trajectorySampler.run();
+    return 0;
+}
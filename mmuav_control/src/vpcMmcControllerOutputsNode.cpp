@@ -0,0 +1,129 @@
+/******************************************************************************
+File name: vpcMmcControllerOutputsNode.cpp
+Description: Merges the height and attitude controller outputs of the
+    VPC MMCUAV into motor velocities and moving mass positions, same as
+    vpc_mmc_controller_outputs_to_motor_velocities.py, on a PeriodicExecutor
+    loop. Nothing is published until both controllers have sent a command.
+******************************************************************************/
+
+#include <mmuav_control/PeriodicExecutor.h>
+
+#include <mav_msgs/Actuators.h>
+#include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
+#include <boost/bind.hpp>
+
+class VpcMmcControllerOutputs
+{
+public:
+    VpcMmcControllerOutputs() : nhParams("~"), rollCommand(0.0),
+        pitchCommand(0.0), yawCommand(0.0), vpcRollCommand(0.0),
+        vpcPitchCommand(0.0), motVelRef(0.0), attitudeReceived(false),
+        motVelRefReceived(false), started(false)
+    {
+        motVelPub = nhTopics.advertise<mav_msgs::Actuators>("command/motors", 1);
+        massFrontPub = nhTopics.advertise<std_msgs::Float64>(
+            "movable_mass_0_position_controller/command", 1);
+        massLeftPub = nhTopics.advertise<std_msgs::Float64>(
+            "movable_mass_1_position_controller/command", 1);
+        massBackPub = nhTopics.advertise<std_msgs::Float64>(
+            "movable_mass_2_position_controller/command", 1);
+        massRightPub = nhTopics.advertise<std_msgs::Float64>(
+            "movable_mass_3_position_controller/command", 1);
+        massAllPub = nhTopics.advertise<std_msgs::Float64MultiArray>(
+            "movable_mass_all/command", 1);
+
+        attitudeSub = nhTopics.subscribe("attitude_command", 1,
+            &VpcMmcControllerOutputs::attitudeCommandCallback, this);
+        motVelRefSub = nhTopics.subscribe("mot_vel_ref", 1,
+            &VpcMmcControllerOutputs::motorVelocityRefCallback, this);
+    }
+
+    void run()
+    {
+        PeriodicExecutor executor(nhParams, nhTopics, 100.0);
+        executor.spin(boost::bind(&VpcMmcControllerOutputs::controlLaw, this,
+            _1, _2));
+    }
+
+private:
+    ros::NodeHandle nhParams, nhTopics;
+    ros::Publisher motVelPub, massFrontPub, massLeftPub, massBackPub,
+        massRightPub, massAllPub;
+    ros::Subscriber attitudeSub, motVelRefSub;
+
+    double rollCommand, pitchCommand, yawCommand;
+    double vpcRollCommand, vpcPitchCommand;
+    double motVelRef;
+    bool attitudeReceived, motVelRefReceived, started;
+
+    void controlLaw(const ros::Time &now, double dt)
+    {
+        if (!attitudeReceived || !motVelRefReceived)
+        {
+            ROS_INFO_THROTTLE(1.0, "Waiting for %s controller to start.",
+                attitudeReceived ? "height" : "attitude");
+            return;
+        }
+        if (!started)
+        {
+            ROS_INFO("Attitude and height control started.");
+            started = true;
+        }
+
+        // Motor velocities, + configuration
+        mav_msgs::Actuators motVelMsg;
+        motVelMsg.header.stamp = now;
+        motVelMsg.angular_velocities.push_back(motVelRef + yawCommand - vpcPitchCommand);
+        motVelMsg.angular_velocities.push_back(motVelRef - yawCommand + vpcRollCommand);
+        motVelMsg.angular_velocities.push_back(motVelRef + yawCommand + vpcPitchCommand);
+        motVelMsg.angular_velocities.push_back(motVelRef - yawCommand - vpcRollCommand);
+        motVelPub.publish(motVelMsg);
+
+        std_msgs::Float64 massMsg;
+        massMsg.data = pitchCommand;
+        massFrontPub.publish(massMsg);
+        massMsg.data = -pitchCommand;
+        massBackPub.publish(massMsg);
+        massMsg.data = -rollCommand;
+        massLeftPub.publish(massMsg);
+        massMsg.data = rollCommand;
+        massRightPub.publish(massMsg);
+
+        std_msgs::Float64MultiArray allMassMsg;
+        allMassMsg.data.push_back(pitchCommand);
+        allMassMsg.data.push_back(-rollCommand);
+        allMassMsg.data.push_back(-pitchCommand);
+        allMassMsg.data.push_back(rollCommand);
+        massAllPub.publish(allMassMsg);
+    }
+
+    void attitudeCommandCallback(const std_msgs::Float64MultiArray &msg)
+    {
+        if (msg.data.size() < 5)
+        {
+            ROS_WARN("Not enough data. Length of data array: %d", int(msg.data.size()));
+            return;
+        }
+        rollCommand = msg.data[0];
+        pitchCommand = msg.data[1];
+        yawCommand = msg.data[2];
+        vpcRollCommand = msg.data[3];
+        vpcPitchCommand = msg.data[4];
+        attitudeReceived = true;
+    }
+
+    void motorVelocityRefCallback(const std_msgs::Float64 &msg)
+    {
+        motVelRef = msg.data;
+        motVelRefReceived = true;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "vpc_mmcuav_merge_controller_outputs");
+    VpcMmcControllerOutputs controllerOutputs;
+    controllerOutputs.run();
+    return 0;
+}
@@ -13,7 +13,6 @@ from dynamic_reconfigure.server import Server
 from mmuav_control.cfg import VpcMmcuavAttitudeCtlParamsConfig
 import math
 from datetime import datetime
-from rosgraph_msgs.msg import Clock
 import simple_filters
 import copy
 
@@ -54,8 +53,6 @@ class AttitudeControl:
         self.euler_rate_mv = Vector3()      # measured angular velocities
         self.euler_rate_mv_old = Vector3()
 
-        self.clock = Clock()
-
         self.pid_roll = PID()                           # roll controller
         self.pid_roll_rate  = PID()                     # roll rate (wx) controller
 
@@ -131,6 +128,16 @@ class AttitudeControl:
         ##################################################################
         ##################################################################
 
+        # Gains set as private parameters, e.g. by a campaign trial, replace
+        # the ones above. The first config callback hands them to the server.
+        for name, pid in [('roll', self.pid_roll), ('roll_r', self.pid_roll_rate),
+                          ('pitch', self.pid_pitch), ('pitch_r', self.pid_pitch_rate),
+                          ('yaw', self.pid_yaw), ('yaw_r', self.pid_yaw_rate),
+                          ('vpc_roll', self.pid_vpc_roll), ('vpc_pitch', self.pid_vpc_pitch)]:
+            pid.set_kp(rospy.get_param('~' + name + '_kp', pid.get_kp()))
+            pid.set_ki(rospy.get_param('~' + name + '_ki', pid.get_ki()))
+            pid.set_kd(rospy.get_param('~' + name + '_kd', pid.get_kd()))
+
         self.rate = rospy.get_param('~rate', 100)
         self.ros_rate = rospy.Rate(self.rate)                 # attitude control at 100 Hz
         self.Ts = 1.0/float(self.rate)
@@ -140,7 +147,6 @@ class AttitudeControl:
         rospy.Subscriber('imu', Imu, self.ahrs_cb)
         rospy.Subscriber('mot_vel_ref', Float64, self.mot_vel_ref_cb)
         rospy.Subscriber('euler_ref', Vector3, self.euler_ref_cb)
-        rospy.Subscriber('/clock', Clock, self.clock_cb)
         rospy.Subscriber('reset_controllers', Empty, self.reset_controllers_cb)
 
         #self.pub_mass0 = rospy.Publisher('movable_mass_0_position_controller/command', Float64, queue_size=1)
@@ -165,6 +171,7 @@ class AttitudeControl:
 
         while (rospy.get_time() == 0) and (not rospy.is_shutdown()):
             print 'Waiting for clock server to start'
+            rospy.rostime.wallsleep(0.1)
 
         print 'Received first clock message'
 
@@ -174,63 +181,64 @@ class AttitudeControl:
         print "Starting attitude control."
 
         self.t_old = rospy.Time.now()
-        clock_old = self.clock
         #self.t_old = datetime.now()
         self.count = 0
         self.loop_count = 0
 
         while not rospy.is_shutdown():
-            #self.ros_rate.sleep()
             while (not self.start_flag) and (not rospy.is_shutdown()):
                 print "Waiting for the first measurement."
                 rospy.sleep(0.5)
-            rospy.sleep(1.0/float(self.rate))
+            # rospy.Rate wakes up at fixed multiples of the period instead of
+            # sleeping a constant time after the loop body, so the loop does
+            # not drift. Prefilters and PIDs get the measured dt.
+            try:
+                self.ros_rate.sleep()
+            except rospy.ROSTimeMovedBackwardsException:
+                # Simulation was reset, restart timing from the new clock.
+                self.t_old = rospy.Time.now()
+                continue
+
+            t = rospy.Time.now()
+            dt = (t - self.t_old).to_sec()
+            if dt <= 0:
+                continue
+            self.t_old = t
+
+            if abs(dt - self.Ts) > 0.005:
+                self.count += 1
+                print self.count, ' - ', dt
 
             self.euler_sp_filt.x = simple_filters.filterPT1(self.euler_sp_old.x, 
-                self.euler_sp.x, self.roll_reference_prefilter_T, self.Ts, 
+                self.euler_sp.x, self.roll_reference_prefilter_T, dt, 
                 self.roll_reference_prefilter_K)
             self.euler_sp_filt.y = simple_filters.filterPT1(self.euler_sp_old.y, 
-                self.euler_sp.y, self.pitch_reference_prefilter_T, self.Ts, 
+                self.euler_sp.y, self.pitch_reference_prefilter_T, dt, 
                 self.pitch_reference_prefilter_K)
             self.euler_sp_filt.z = self.euler_sp.z
             #self.euler_sp.z = simple_filters.filterPT1(self.euler_sp_old.z, self.euler_sp.z, 0.2, self.Ts, 1.0)
 
             self.euler_sp_old = copy.deepcopy(self.euler_sp_filt)
 
-            clock_now = self.clock
-            dt_clk = (clock_now.clock - clock_old.clock).to_sec()
-
-            clock_old = clock_now
-            if dt_clk > (1.0 / self.rate + 0.005):
-                self.count += 1
-                print self.count, ' - ',  dt_clk
-
-            if dt_clk < (1.0 / self.rate - 0.005):
-                self.count += 1
-                print self.count, ' - ',  dt_clk
-
-            if dt_clk < 0.005:
-                dt_clk = 0.01
-
             # Roll
-            roll_rate_sv = self.pid_roll.compute(self.euler_sp_filt.x, self.euler_mv.x, dt_clk)
+            roll_rate_sv = self.pid_roll.compute(self.euler_sp_filt.x, self.euler_mv.x, dt)
             # roll rate pid compute
-            roll_rate_output = self.pid_roll_rate.compute(roll_rate_sv, self.euler_rate_mv.x, dt_clk) + self.roll_rate_output_trim
+            roll_rate_output = self.pid_roll_rate.compute(roll_rate_sv, self.euler_rate_mv.x, dt) + self.roll_rate_output_trim
 
             # Pitch
-            pitch_rate_sv = self.pid_pitch.compute(self.euler_sp_filt.y, self.euler_mv.y, dt_clk)
+            pitch_rate_sv = self.pid_pitch.compute(self.euler_sp_filt.y, self.euler_mv.y, dt)
             # pitch rate pid compute
-            pitch_rate_output = self.pid_pitch_rate.compute(pitch_rate_sv, self.euler_rate_mv.y, dt_clk) + self.pitch_rate_output_trim
+            pitch_rate_output = self.pid_pitch_rate.compute(pitch_rate_sv, self.euler_rate_mv.y, dt) + self.pitch_rate_output_trim
 
             # Yaw
-            yaw_rate_sv = self.pid_yaw.compute(self.euler_sp_filt.z, self.euler_mv.z, dt_clk)
+            yaw_rate_sv = self.pid_yaw.compute(self.euler_sp_filt.z, self.euler_mv.z, dt)
             # yaw rate pid compute
-            yaw_rate_output = self.pid_yaw_rate.compute(yaw_rate_sv, self.euler_rate_mv.z, dt_clk)
+            yaw_rate_output = self.pid_yaw_rate.compute(yaw_rate_sv, self.euler_rate_mv.z, dt)
 
             # VPC stuff
-            vpc_roll_output = -self.pid_vpc_roll.compute(0.0, roll_rate_output, dt_clk)
+            vpc_roll_output = -self.pid_vpc_roll.compute(0.0, roll_rate_output, dt)
             # Due to some wiring errors we set output to +, should be -
-            vpc_pitch_output = -self.pid_vpc_pitch.compute(0.0, pitch_rate_output, dt_clk)
+            vpc_pitch_output = -self.pid_vpc_pitch.compute(0.0, pitch_rate_output, dt)
 
 
             # Publish mass position
@@ -338,9 +346,6 @@ class AttitudeControl:
         '''
         self.euler_sp = msg
 
-    def clock_cb(self, msg):
-        self.clock = msg
-
     def cfg_callback(self, config, level):
         """ Callback for dynamically reconfigurable parameters (P,I,D gains for each controller)
         """
@@ -69,6 +69,13 @@ class HeightControl:
         self.pid_vz.set_lim_high(500)   # max velocity of a motor
         self.pid_vz.set_lim_low(-500)   # min velocity of a motor
 
+        # Gains set as private parameters, e.g. by a campaign trial, replace
+        # the ones above. The first config callback hands them to the server.
+        for name, pid in [('z', self.pid_z), ('vz', self.pid_vz)]:
+            pid.set_kp(rospy.get_param('~' + name + '_kp', pid.get_kp()))
+            pid.set_ki(rospy.get_param('~' + name + '_ki', pid.get_ki()))
+            pid.set_kd(rospy.get_param('~' + name + '_kd', pid.get_kd()))
+
         self.mot_speed = 0              # referent motors velocity, computed by PID cascade
 
         self.t_old = 0
@@ -101,7 +108,15 @@ class HeightControl:
         #self.t_old = datetime.now()
 
         while not rospy.is_shutdown():
-            rospy.sleep(1.0/float(self.rate))
+            # rospy.Rate wakes up at fixed multiples of the period instead of
+            # sleeping a constant time after the loop body, so the loop does
+            # not drift. The PIDs get the measured dt.
+            try:
+                self.ros_rate.sleep()
+            except rospy.ROSTimeMovedBackwardsException:
+                # Simulation was reset, restart timing from the new clock.
+                self.t_old = rospy.Time.now()
+                continue
 
             ########################################################
             ########################################################
@@ -116,11 +131,8 @@ class HeightControl:
             #self.gm_attitude_ctl = 1  # don't forget to set me to 1 when you implement attitude ctl
             t = rospy.Time.now()
             dt = (t - self.t_old).to_sec()
-            #t = datetime.now()
-            #dt = (t - self.t_old).total_seconds()
-            if dt > 1.05/float(self.rate) or dt < 0.95/float(self.rate):
-                #print dt
-                pass
+            if dt <= 0:
+                continue
 
             self.t_old = t
             #                              (m_uav + m_arms)/(C*4)
@@ -0,0 +1,98 @@
+/******************************************************************************
+File name: trajectoryCacheTest.cpp
+Description: A translated and yaw-rotated copy of a planned request gets the
+    same segment times and is served from the TrajectoryCache.
+******************************************************************************/
+
+#include <mmuav_control/TrajectoryCache.h>
+
+#include <cmath>
+#include <gtest/gtest.h>
+
+namespace
+{
+Eigen::MatrixXd squareKeyframes()
+{
+    Eigen::MatrixXd keyframes(PolynomialTrajectory::AXES, 4);
+    keyframes << 0.0, 2.0, 2.0, 0.5,
+                 0.0, 0.0, 1.0, 1.5,
+                 1.0, 1.5, 2.0, 1.0,
+                 0.0, 0.5, 1.5, 1.0;
+    return keyframes;
+}
+
+// Rotates the keyframes by angle about z and moves them by offset
+Eigen::MatrixXd rotatedCopy(const Eigen::MatrixXd &keyframes, double angle,
+    const Eigen::Vector3d &offset)
+{
+    Eigen::MatrixXd copy = keyframes;
+    double c = cos(angle), s = sin(angle);
+    for (int i = 0; i < keyframes.cols(); i++)
+    {
+        copy(0, i) = c*keyframes(0, i) - s*keyframes(1, i) + offset(0);
+        copy(1, i) = s*keyframes(0, i) + c*keyframes(1, i) + offset(1);
+        copy(2, i) = keyframes(2, i) + offset(2);
+        copy(3, i) = keyframes(3, i) + angle;
+    }
+    return copy;
+}
+}
+
+TEST(TrajectoryCache, RotatedCopyHitsCache)
+{
+    MinSnapPlanner planner;
+    TrajectoryCache cache;
+
+    Eigen::MatrixXd keyframes = squareKeyframes();
+    Eigen::VectorXd T = MinSnapPlanner::generateT(
+        TrajectoryCache::normalize(keyframes));
+    PolynomialTrajectory trajectory;
+    ASSERT_TRUE(planner.plan(keyframes, T, trajectory));
+    cache.insert(keyframes, T, planner.getPolyOrder(), trajectory);
+
+    Eigen::MatrixXd copy = rotatedCopy(keyframes, 0.7,
+        Eigen::Vector3d(3.0, -1.0, 0.5));
+    Eigen::VectorXd copyT = MinSnapPlanner::generateT(
+        TrajectoryCache::normalize(copy));
+    EXPECT_TRUE(copyT.isApprox(T, 1e-9));
+
+    PolynomialTrajectory cached;
+    ASSERT_TRUE(cache.lookup(copy, copyT, planner.getPolyOrder(), cached));
+    EXPECT_EQ(1u, cache.getHits());
+
+    // The cached trajectory passes through the keyframes of the copy
+    double t = 0.0;
+    for (int i = 0; i < copy.cols(); i++)
+    {
+        Eigen::Vector4d position = cached.evaluate(t, 0);
+        EXPECT_TRUE(position.isApprox(Eigen::Vector4d(copy.col(i)), 1e-6))
+            << "keyframe " << i << ": " << position.transpose();
+        if (i < cached.segments()) t += cached.T(i);
+    }
+}
+
+TEST(TrajectoryCache, DifferentShapeMisses)
+{
+    MinSnapPlanner planner;
+    TrajectoryCache cache;
+
+    Eigen::MatrixXd keyframes = squareKeyframes();
+    Eigen::VectorXd T = MinSnapPlanner::generateT(
+        TrajectoryCache::normalize(keyframes));
+    PolynomialTrajectory trajectory;
+    ASSERT_TRUE(planner.plan(keyframes, T, trajectory));
+    cache.insert(keyframes, T, planner.getPolyOrder(), trajectory);
+
+    Eigen::MatrixXd other = keyframes;
+    other(0, 2) += 0.5;
+    Eigen::VectorXd otherT = MinSnapPlanner::generateT(
+        TrajectoryCache::normalize(other));
+    EXPECT_FALSE(cache.lookup(other, otherT, planner.getPolyOrder(), trajectory));
+    EXPECT_EQ(1u, cache.getMisses());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,927 @@
+/*
+ * Bakes simplified collision meshes from the COLLADA visual meshes.
+ *
+ * Every geometry instance of the visual scene is replaced by its convex
+ * hull, reduced to at most --max-vertices vertices by inserting the hull
+ * vertices farthest outside the current approximation first. The result is
+ * written as binary STL next to the original (<name>_collision.stl), in the
+ * same frame and units Gazebo loads the .dae in, so it can be swapped in for
+ * the visual mesh with the same origin and scale.
+ *
+ * With --xacro the tool also writes the collision_mesh macro that selects
+ * the baked mesh or the visual one with the collision_meshes xacro arg.
+ *
+ * The tool has no dependencies so it can run at build time, meshes whose
+ * STL is newer than the .dae are skipped unless --force is given.
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// -----------------------------------------------------------------------------
+// Minimal XML DOM, enough for COLLADA: elements, attributes and text.
+// -----------------------------------------------------------------------------
+struct XmlElement {
+  std::string name;
+  std::map<std::string, std::string> attributes;
+  std::string text;
+  std::vector<std::unique_ptr<XmlElement>> children;
+
+  std::string Attribute(const std::string& key,
+                        const std::string& fallback = "") const {
+    auto it = attributes.find(key);
+    return it == attributes.end() ? fallback : it->second;
+  }
+
+  const XmlElement* Child(const std::string& child_name) const {
+    for (const auto& child : children)
+      if (child->name == child_name) return child.get();
+    return nullptr;
+  }
+};
+
+class XmlParser {
+ public:
+  explicit XmlParser(const std::string& data) : data_(data), pos_(0) {}
+
+  std::unique_ptr<XmlElement> Parse() {
+    std::unique_ptr<XmlElement> root;
+    while (SkipToTag()) {
+      if (Skip("<?", "?>") || Skip("<!--", "-->") || Skip("<!", ">"))
+        continue;
+      root = ParseElement();
+      break;
+    }
+    if (!root) throw std::runtime_error("no root element");
+    return root;
+  }
+
+ private:
+  const std::string& data_;
+  size_t pos_;
+
+  bool SkipToTag() {
+    pos_ = data_.find('<', pos_);
+    return pos_ != std::string::npos;
+  }
+
+  bool Skip(const char* open, const char* close) {
+    if (data_.compare(pos_, strlen(open), open) != 0) return false;
+    size_t end = data_.find(close, pos_);
+    if (end == std::string::npos) throw std::runtime_error("unterminated tag");
+    pos_ = end + strlen(close);
+    return true;
+  }
+
+  void SkipSpace() {
+    while (pos_ < data_.size() && isspace((unsigned char)data_[pos_])) pos_++;
+  }
+
+  std::string ParseName() {
+    size_t start = pos_;
+    while (pos_ < data_.size() && !isspace((unsigned char)data_[pos_]) &&
+           data_[pos_] != '>' && data_[pos_] != '/' && data_[pos_] != '=')
+      pos_++;
+    return data_.substr(start, pos_ - start);
+  }
+
+  std::unique_ptr<XmlElement> ParseElement() {
+    std::unique_ptr<XmlElement> element(new XmlElement);
+    pos_++;  // '<'
+    element->name = ParseName();
+    for (;;) {
+      SkipSpace();
+      if (pos_ >= data_.size())
+        throw std::runtime_error("file ends inside <" + element->name + ">");
+      if (data_.compare(pos_, 2, "/>") == 0) {
+        pos_ += 2;
+        return element;
+      }
+      if (data_[pos_] == '>') {
+        pos_++;
+        break;
+      }
+      std::string key = ParseName();
+      SkipSpace();
+      if (pos_ >= data_.size() || data_[pos_] != '=')
+        throw std::runtime_error("bad attribute in <" + element->name + ">");
+      pos_++;
+      SkipSpace();
+      char quote = data_[pos_];
+      size_t end = data_.find(quote, pos_ + 1);
+      if (end == std::string::npos)
+        throw std::runtime_error("unterminated attribute");
+      element->attributes[key] = data_.substr(pos_ + 1, end - pos_ - 1);
+      pos_ = end + 1;
+    }
+
+    for (;;) {
+      size_t start = pos_;
+      if (!SkipToTag())
+        throw std::runtime_error("file ends inside <" + element->name + ">");
+      element->text.append(data_, start, pos_ - start);
+      if (data_.compare(pos_, 2, "</") == 0) {
+        pos_ = data_.find('>', pos_);
+        if (pos_ == std::string::npos)
+          throw std::runtime_error("unterminated closing tag");
+        pos_++;
+        return element;
+      }
+      if (data_.compare(pos_, 9, "<![CDATA[") == 0) {
+        size_t end = data_.find("]]>", pos_);
+        if (end == std::string::npos)
+          throw std::runtime_error("unterminated CDATA");
+        element->text.append(data_, pos_ + 9, end - pos_ - 9);
+        pos_ = end + 3;
+        continue;
+      }
+      if (Skip("<?", "?>") || Skip("<!--", "-->")) continue;
+      element->children.push_back(ParseElement());
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Geometry
+// -----------------------------------------------------------------------------
+struct Vec3 {
+  double x, y, z;
+  Vec3() : x(0), y(0), z(0) {}
+  Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+  Vec3 operator+(const Vec3& o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+  Vec3 operator-(const Vec3& o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+  Vec3 operator*(double s) const { return Vec3(x * s, y * s, z * s); }
+  double Dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+  Vec3 Cross(const Vec3& o) const {
+    return Vec3(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x);
+  }
+  double Norm() const { return std::sqrt(Dot(*this)); }
+};
+
+// Row major 4x4 transform
+struct Matrix4 {
+  double m[16];
+
+  static Matrix4 Identity() {
+    Matrix4 r;
+    for (int i = 0; i < 16; i++) r.m[i] = (i % 5 == 0) ? 1.0 : 0.0;
+    return r;
+  }
+
+  Matrix4 operator*(const Matrix4& o) const {
+    Matrix4 r;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++) {
+        double sum = 0.0;
+        for (int k = 0; k < 4; k++) sum += m[4 * i + k] * o.m[4 * k + j];
+        r.m[4 * i + j] = sum;
+      }
+    return r;
+  }
+
+  Vec3 Apply(const Vec3& p) const {
+    return Vec3(m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+                m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+                m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]);
+  }
+};
+
+std::vector<double> ParseNumbers(const std::string& text) {
+  std::vector<double> values;
+  const char* p = text.c_str();
+  char* end;
+  for (;;) {
+    double value = strtod(p, &end);
+    if (end == p) break;
+    values.push_back(value);
+    p = end;
+  }
+  return values;
+}
+
+// Convex hull built by point insertion, one at a time or all at once with
+// quickhull. Faces are kept counterclockwise seen from outside, neighbours
+// are found through a map of directed edges.
+class ConvexHull {
+ public:
+  struct Face {
+    int v[3];
+    Vec3 normal;
+    double offset;
+    bool alive;
+  };
+
+  ConvexHull(const std::vector<Vec3>& points, double epsilon)
+      : points_(points), epsilon_(epsilon) {}
+
+  // Starts the hull with the tetrahedron a, b, c, d
+  void Start(int a, int b, int c, int d) {
+    faces_.clear();
+    edges_.clear();
+    vertices_.clear();
+    Vec3 inside = (points_[a] + points_[b] + points_[c] + points_[d]) * 0.25;
+    int tetra[4][3] = {{a, b, c}, {a, b, d}, {a, c, d}, {b, c, d}};
+    for (auto& t : tetra) {
+      Vec3 normal = (points_[t[1]] - points_[t[0]])
+                        .Cross(points_[t[2]] - points_[t[0]]);
+      if (normal.Dot(inside - points_[t[0]]) > 0)
+        AddFace(t[0], t[2], t[1]);
+      else
+        AddFace(t[0], t[1], t[2]);
+    }
+    vertices_ = {a, b, c, d};
+  }
+
+  // Largest signed distance of point i outside the hull
+  double Distance(int i) const {
+    double distance = -1e300;
+    for (const Face& face : faces_)
+      if (face.alive)
+        distance = std::max(distance, face.normal.Dot(points_[i]) - face.offset);
+    return distance;
+  }
+
+  // Adds point i, returns false if it is already inside
+  bool Add(int i) {
+    int seed = -1;
+    double farthest = epsilon_;
+    for (size_t f = 0; f < faces_.size(); f++) {
+      if (!faces_[f].alive) continue;
+      double distance = FaceDistance(int(f), i);
+      if (distance > farthest) {
+        farthest = distance;
+        seed = int(f);
+      }
+    }
+    if (seed < 0) return false;
+    Insert(i, seed);
+    return true;
+  }
+
+  // Adds all candidates with quickhull: every outside point waits on one
+  // face it sees, each round inserts the farthest point of a face and hands
+  // the points of the removed faces over to the new ones.
+  void Build(const std::vector<int>& candidates) {
+    outside_.assign(faces_.size(), std::vector<int>());
+    Assign(candidates, 0);
+    for (size_t f = 0; f < faces_.size(); f++) {
+      if (!faces_[f].alive || outside_[f].empty()) continue;
+      std::vector<int> waiting;
+      waiting.swap(outside_[f]);
+      int farthest = waiting[0];
+      for (int i : waiting)
+        if (FaceDistance(int(f), i) > FaceDistance(int(f), farthest))
+          farthest = i;
+
+      size_t first_new = faces_.size();
+      std::vector<int> removed = Insert(farthest, int(f));
+      outside_.resize(faces_.size());
+      for (int r : removed) {
+        waiting.insert(waiting.end(), outside_[r].begin(), outside_[r].end());
+        outside_[r].clear();
+      }
+      waiting.erase(std::remove(waiting.begin(), waiting.end(), farthest),
+                    waiting.end());
+      Assign(waiting, first_new);
+    }
+    outside_.clear();
+  }
+
+  // Drops vertices no longer on the hull after all insertions
+  std::vector<int> Vertices() const {
+    std::vector<char> used(points_.size(), 0);
+    for (const Face& face : faces_)
+      if (face.alive)
+        for (int e = 0; e < 3; e++) used[face.v[e]] = 1;
+    std::vector<int> result;
+    for (int v : vertices_)
+      if (used[v]) result.push_back(v);
+    return result;
+  }
+
+  const std::vector<Face>& Faces() const { return faces_; }
+
+ private:
+  const std::vector<Vec3>& points_;
+  double epsilon_;
+  std::vector<Face> faces_;
+  std::unordered_map<long long, int> edges_;
+  std::vector<int> vertices_;
+  std::vector<std::vector<int>> outside_;
+
+  long long EdgeKey(int a, int b) const {
+    return (long long)a * (long long)points_.size() + b;
+  }
+
+  int EdgeFace(int a, int b) const {
+    auto it = edges_.find(EdgeKey(a, b));
+    return it == edges_.end() ? -1 : it->second;
+  }
+
+  // Replaces the faces visible from point i, starting at seed, by a cone
+  // to i. Returns the removed faces, the new ones are appended.
+  std::vector<int> Insert(int i, int seed) {
+    const Vec3& p = points_[i];
+    // Visible region grown from the most visible face keeps the horizon a
+    // single loop even with nearly coplanar faces.
+    std::vector<int> visible(1, seed);
+    std::vector<char> is_visible(faces_.size(), 0);
+    is_visible[seed] = 1;
+    for (size_t k = 0; k < visible.size(); k++) {
+      const Face& face = faces_[visible[k]];
+      for (int e = 0; e < 3; e++) {
+        int neighbour = EdgeFace(face.v[(e + 1) % 3], face.v[e]);
+        if (neighbour < 0 || is_visible[neighbour]) continue;
+        const Face& other = faces_[neighbour];
+        if (other.normal.Dot(p) - other.offset > -epsilon_) {
+          is_visible[neighbour] = 1;
+          visible.push_back(neighbour);
+        }
+      }
+    }
+
+    std::vector<std::pair<int, int>> horizon;
+    for (int f : visible) {
+      const Face& face = faces_[f];
+      for (int e = 0; e < 3; e++) {
+        int a = face.v[e], b = face.v[(e + 1) % 3];
+        int neighbour = EdgeFace(b, a);
+        if (neighbour < 0 || !is_visible[neighbour])
+          horizon.push_back(std::make_pair(a, b));
+      }
+    }
+    for (int f : visible) RemoveFace(f);
+    for (const auto& edge : horizon) AddFace(edge.first, edge.second, i);
+    vertices_.push_back(i);
+    return visible;
+  }
+
+  double FaceDistance(int f, int i) const {
+    return faces_[f].normal.Dot(points_[i]) - faces_[f].offset;
+  }
+
+  void Assign(const std::vector<int>& candidates, size_t first_face) {
+    for (int i : candidates)
+      for (size_t f = first_face; f < faces_.size(); f++)
+        if (faces_[f].alive && FaceDistance(int(f), i) > epsilon_) {
+          outside_[f].push_back(i);
+          break;
+        }
+  }
+
+  void AddFace(int a, int b, int c) {
+    Face face;
+    face.v[0] = a;
+    face.v[1] = b;
+    face.v[2] = c;
+    face.normal = (points_[b] - points_[a]).Cross(points_[c] - points_[a]);
+    double norm = face.normal.Norm();
+    if (norm > 0) face.normal = face.normal * (1.0 / norm);
+    face.offset = face.normal.Dot(points_[a]);
+    face.alive = true;
+    int index = int(faces_.size());
+    faces_.push_back(face);
+    for (int e = 0; e < 3; e++)
+      edges_[EdgeKey(face.v[e], face.v[(e + 1) % 3])] = index;
+  }
+
+  void RemoveFace(int f) {
+    Face& face = faces_[f];
+    face.alive = false;
+    for (int e = 0; e < 3; e++) {
+      auto it = edges_.find(EdgeKey(face.v[e], face.v[(e + 1) % 3]));
+      if (it != edges_.end() && it->second == f) edges_.erase(it);
+    }
+  }
+};
+
+struct Triangle {
+  Vec3 v[3];
+};
+
+struct HullResult {
+  int input_points;
+  int hull_vertices;
+  int kept_vertices;
+  double error;  // largest distance of a dropped hull vertex [m]
+  double size;   // bounding box diagonal [m]
+};
+
+// Finds four well spread, non coplanar points among candidates
+bool InitialTetrahedron(const std::vector<Vec3>& points,
+                        const std::vector<int>& candidates, double epsilon,
+                        int tetra[4]) {
+  int a = candidates[0];
+  for (int i : candidates)
+    if (points[i].x < points[a].x) a = i;
+
+  int b = -1;
+  double best = epsilon;
+  for (int i : candidates) {
+    double distance = (points[i] - points[a]).Norm();
+    if (distance > best) best = distance, b = i;
+  }
+  if (b < 0) return false;
+
+  int c = -1;
+  best = epsilon;
+  Vec3 ab = points[b] - points[a];
+  for (int i : candidates) {
+    double distance = ab.Cross(points[i] - points[a]).Norm() / ab.Norm();
+    if (distance > best) best = distance, c = i;
+  }
+  if (c < 0) return false;
+
+  int d = -1;
+  best = epsilon;
+  Vec3 normal = ab.Cross(points[c] - points[a]);
+  normal = normal * (1.0 / normal.Norm());
+  for (int i : candidates) {
+    double distance = std::fabs(normal.Dot(points[i] - points[a]));
+    if (distance > best) best = distance, d = i;
+  }
+  if (d < 0) return false;
+
+  tetra[0] = a;
+  tetra[1] = b;
+  tetra[2] = c;
+  tetra[3] = d;
+  return true;
+}
+
+// Convex hull of points with at most max_vertices vertices (0 - exact),
+// appended to triangles. The reduced hull keeps the vertices that stick out
+// the most, so it lies inside the exact one by at most result.error.
+bool BakeHull(const std::vector<Vec3>& points, int max_vertices,
+              double tolerance, std::vector<Triangle>& triangles,
+              HullResult& result) {
+  result.input_points = int(points.size());
+  if (points.size() < 4) return false;
+
+  Vec3 low = points[0], high = points[0];
+  for (const Vec3& p : points) {
+    low = Vec3(std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z));
+    high = Vec3(std::max(high.x, p.x), std::max(high.y, p.y),
+                std::max(high.z, p.z));
+  }
+  result.size = (high - low).Norm();
+  double epsilon = 1e-7 * std::max(1e-12, result.size);
+
+  std::vector<int> all(points.size());
+  for (size_t i = 0; i < points.size(); i++) all[i] = int(i);
+  int tetra[4];
+  if (!InitialTetrahedron(points, all, epsilon, tetra)) return false;
+
+  ConvexHull exact(points, epsilon);
+  exact.Start(tetra[0], tetra[1], tetra[2], tetra[3]);
+  exact.Build(all);
+  std::vector<int> hull_vertices = exact.Vertices();
+  result.hull_vertices = int(hull_vertices.size());
+  result.kept_vertices = result.hull_vertices;
+  result.error = 0.0;
+
+  const ConvexHull* hull = &exact;
+  ConvexHull reduced(points, epsilon);
+  if (max_vertices > 0 && result.hull_vertices > max_vertices) {
+    // Farthest point insertion over the exact hull vertices
+    InitialTetrahedron(points, hull_vertices, epsilon, tetra);
+    reduced.Start(tetra[0], tetra[1], tetra[2], tetra[3]);
+    int kept = 4;
+    for (;;) {
+      int farthest = -1;
+      double distance = epsilon;
+      for (int i : hull_vertices) {
+        double d = reduced.Distance(i);
+        if (d > distance) distance = d, farthest = i;
+      }
+      result.error = std::max(0.0, distance);
+      if (farthest < 0 || kept >= max_vertices || distance <= tolerance) break;
+      reduced.Add(farthest);
+      kept++;
+    }
+    result.kept_vertices = int(reduced.Vertices().size());
+    hull = &reduced;
+  }
+
+  for (const auto& face : hull->Faces()) {
+    if (!face.alive) continue;
+    Triangle triangle;
+    for (int e = 0; e < 3; e++) triangle.v[e] = points[face.v[e]];
+    triangles.push_back(triangle);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// COLLADA
+// -----------------------------------------------------------------------------
+class ColladaMesh {
+ public:
+  // Points of every geometry instance in the visual scene, in meters and
+  // the root frame of the scene
+  std::vector<std::vector<Vec3>> instances;
+
+  void Load(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) throw std::runtime_error("can't open " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string data = buffer.str();
+    root_ = XmlParser(data).Parse();
+    if (root_->name != "COLLADA") throw std::runtime_error("not a COLLADA file");
+    IndexIds(root_.get());
+
+    Matrix4 unit = Matrix4::Identity();
+    const XmlElement* asset = root_->Child("asset");
+    const XmlElement* unit_element = asset ? asset->Child("unit") : nullptr;
+    if (unit_element) {
+      double meter = atof(unit_element->Attribute("meter", "1").c_str());
+      if (meter > 0) unit.m[0] = unit.m[5] = unit.m[10] = meter;
+    }
+
+    const XmlElement* scene = FindScene();
+    if (scene) {
+      for (const auto& node : scene->children)
+        if (node->name == "node") AddNode(node.get(), unit, 0);
+    } else {
+      // No scene, every geometry in its own frame
+      const XmlElement* library = root_->Child("library_geometries");
+      if (library)
+        for (const auto& geometry : library->children)
+          if (geometry->name == "geometry") AddGeometry(geometry.get(), unit);
+    }
+  }
+
+ private:
+  std::unique_ptr<XmlElement> root_;
+  std::map<std::string, const XmlElement*> ids_;
+
+  void IndexIds(const XmlElement* element) {
+    std::string id = element->Attribute("id");
+    if (!id.empty()) ids_[id] = element;
+    for (const auto& child : element->children) IndexIds(child.get());
+  }
+
+  const XmlElement* Lookup(const std::string& url) const {
+    std::string id = (!url.empty() && url[0] == '#') ? url.substr(1) : url;
+    auto it = ids_.find(id);
+    return it == ids_.end() ? nullptr : it->second;
+  }
+
+  const XmlElement* FindScene() const {
+    const XmlElement* scene = root_->Child("scene");
+    const XmlElement* instance =
+        scene ? scene->Child("instance_visual_scene") : nullptr;
+    if (instance) return Lookup(instance->Attribute("url"));
+    const XmlElement* library = root_->Child("library_visual_scenes");
+    return library ? library->Child("visual_scene") : nullptr;
+  }
+
+  static Matrix4 LocalTransform(const XmlElement* node) {
+    Matrix4 transform = Matrix4::Identity();
+    for (const auto& child : node->children) {
+      std::vector<double> v = ParseNumbers(child->text);
+      Matrix4 local = Matrix4::Identity();
+      if (child->name == "matrix" && v.size() == 16) {
+        std::copy(v.begin(), v.end(), local.m);
+      } else if (child->name == "translate" && v.size() == 3) {
+        local.m[3] = v[0];
+        local.m[7] = v[1];
+        local.m[11] = v[2];
+      } else if (child->name == "scale" && v.size() == 3) {
+        local.m[0] = v[0];
+        local.m[5] = v[1];
+        local.m[10] = v[2];
+      } else if (child->name == "rotate" && v.size() == 4) {
+        Vec3 axis(v[0], v[1], v[2]);
+        double norm = axis.Norm();
+        if (norm == 0) continue;
+        axis = axis * (1.0 / norm);
+        double angle = v[3] * M_PI / 180.0;
+        double c = std::cos(angle), s = std::sin(angle), t = 1.0 - c;
+        double r[9] = {t * axis.x * axis.x + c, t * axis.x * axis.y - s * axis.z,
+                       t * axis.x * axis.z + s * axis.y,
+                       t * axis.x * axis.y + s * axis.z, t * axis.y * axis.y + c,
+                       t * axis.y * axis.z - s * axis.x,
+                       t * axis.x * axis.z - s * axis.y,
+                       t * axis.y * axis.z + s * axis.x, t * axis.z * axis.z + c};
+        for (int i = 0; i < 3; i++)
+          for (int j = 0; j < 3; j++) local.m[4 * i + j] = r[3 * i + j];
+      } else {
+        continue;
+      }
+      transform = transform * local;
+    }
+    return transform;
+  }
+
+  void AddNode(const XmlElement* node, const Matrix4& parent, int depth) {
+    if (depth > 64) throw std::runtime_error("node hierarchy too deep");
+    Matrix4 transform = parent * LocalTransform(node);
+    for (const auto& child : node->children) {
+      if (child->name == "node") {
+        AddNode(child.get(), transform, depth + 1);
+      } else if (child->name == "instance_node") {
+        const XmlElement* instanced = Lookup(child->Attribute("url"));
+        if (instanced) AddNode(instanced, transform, depth + 1);
+      } else if (child->name == "instance_geometry") {
+        const XmlElement* geometry = Lookup(child->Attribute("url"));
+        if (geometry) AddGeometry(geometry, transform);
+      }
+    }
+  }
+
+  // Positions of a <source>, honouring the accessor stride and offset
+  std::vector<Vec3> SourcePositions(const XmlElement* source) const {
+    const XmlElement* array = source->Child("float_array");
+    if (!array) throw std::runtime_error("position source without float_array");
+    std::vector<double> values = ParseNumbers(array->text);
+    size_t stride = 3, offset = 0, count = values.size() / 3;
+    const XmlElement* common = source->Child("technique_common");
+    const XmlElement* accessor = common ? common->Child("accessor") : nullptr;
+    if (accessor) {
+      stride = std::max(3, atoi(accessor->Attribute("stride", "3").c_str()));
+      offset = atoi(accessor->Attribute("offset", "0").c_str());
+      count = atoi(accessor->Attribute("count", "0").c_str());
+    }
+    if (offset + count * stride > values.size())
+      throw std::runtime_error("float_array shorter than its accessor");
+    std::vector<Vec3> positions(count);
+    for (size_t i = 0; i < count; i++) {
+      const double* v = &values[offset + i * stride];
+      positions[i] = Vec3(v[0], v[1], v[2]);
+    }
+    return positions;
+  }
+
+  void AddGeometry(const XmlElement* geometry, const Matrix4& transform) {
+    const XmlElement* mesh = geometry->Child("mesh");
+    if (!mesh) return;  // splines and convex_mesh are not used by Gazebo
+    const XmlElement* vertices = mesh->Child("vertices");
+    if (!vertices) throw std::runtime_error("mesh without <vertices>");
+    std::vector<Vec3> positions;
+    for (const auto& input : vertices->children) {
+      if (input->name == "input" && input->Attribute("semantic") == "POSITION") {
+        const XmlElement* source = Lookup(input->Attribute("source"));
+        if (!source) throw std::runtime_error("missing position source");
+        positions = SourcePositions(source);
+      }
+    }
+
+    // Only positions referenced by primitives count, topology doesn't
+    // matter for the hull.
+    std::vector<char> used(positions.size(), 0);
+    bool any_primitive = false;
+    for (const auto& primitive : mesh->children) {
+      const std::string& name = primitive->name;
+      if (name != "triangles" && name != "polylist" && name != "polygons" &&
+          name != "tristrips" && name != "trifans")
+        continue;
+      any_primitive = true;
+      int vertex_offset = -1, stride = 0;
+      for (const auto& input : primitive->children) {
+        if (input->name != "input") continue;
+        int offset = atoi(input->Attribute("offset", "0").c_str());
+        stride = std::max(stride, offset + 1);
+        if (input->Attribute("semantic") == "VERTEX") vertex_offset = offset;
+      }
+      if (vertex_offset < 0) continue;
+      for (const auto& p : primitive->children) {
+        if (p->name != "p") continue;
+        std::vector<double> indices = ParseNumbers(p->text);
+        for (size_t k = vertex_offset; k < indices.size(); k += stride) {
+          size_t index = size_t(indices[k]);
+          if (index >= positions.size())
+            throw std::runtime_error("vertex index out of range");
+          used[index] = 1;
+        }
+      }
+    }
+
+    std::vector<Vec3> points;
+    for (size_t i = 0; i < positions.size(); i++)
+      if (used[i] || !any_primitive)
+        points.push_back(transform.Apply(positions[i]));
+    if (!points.empty()) instances.push_back(points);
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Output
+// -----------------------------------------------------------------------------
+void WriteStl(const std::string& path, const std::string& name,
+              const std::vector<Triangle>& triangles) {
+  std::ofstream file(path.c_str(), std::ios::binary);
+  if (!file) throw std::runtime_error("can't write " + path);
+  char header[80];
+  memset(header, 0, sizeof header);
+  snprintf(header, sizeof header, "collision hull of %s", name.c_str());
+  file.write(header, sizeof header);
+  uint32_t count = uint32_t(triangles.size());
+  file.write((const char*)&count, sizeof count);
+  for (const Triangle& triangle : triangles) {
+    Vec3 normal = (triangle.v[1] - triangle.v[0])
+                      .Cross(triangle.v[2] - triangle.v[0]);
+    double norm = normal.Norm();
+    if (norm > 0) normal = normal * (1.0 / norm);
+    float data[12] = {float(normal.x), float(normal.y), float(normal.z)};
+    for (int e = 0; e < 3; e++) {
+      data[3 + 3 * e] = float(triangle.v[e].x);
+      data[4 + 3 * e] = float(triangle.v[e].y);
+      data[5 + 3 * e] = float(triangle.v[e].z);
+    }
+    file.write((const char*)data, sizeof data);
+    uint16_t attributes = 0;
+    file.write((const char*)&attributes, sizeof attributes);
+  }
+  if (!file) throw std::runtime_error("error writing " + path);
+}
+
+void WriteXacro(const std::string& path, const std::vector<std::string>& meshes,
+                const std::string& package) {
+  std::ofstream file(path.c_str());
+  if (!file) throw std::runtime_error("can't write " + path);
+  std::string list;
+  for (size_t i = 0; i < meshes.size(); i++)
+    list += (i ? ", '" : "'") + meshes[i] + "'";
+
+  file << "<?xml version=\"1.0\"?>\n"
+          "<!-- Generated by collision_mesh_baker, do not edit. -->\n"
+          "<robot xmlns:xacro=\"http://ros.org/wiki/xacro\">\n"
+          "  <!-- visual: collide with the visual meshes, hull: with the baked"
+          " convex hulls -->\n"
+          "  <xacro:arg name=\"collision_meshes\" default=\"visual\" />\n"
+          "  <xacro:property name=\"collision_meshes\""
+          " value=\"$(arg collision_meshes)\" />\n"
+          "  <xacro:property name=\"baked_collision_meshes\""
+          " value=\"${[" << list << "]}\" />\n"
+          "\n"
+          "  <!-- Collision mesh for a visual mesh file in meshes/, falls back"
+          " to the\n"
+          "    visual mesh for meshes that weren't baked -->\n"
+          "  <xacro:macro name=\"collision_mesh\""
+          " params=\"mesh_file scale:='1 1 1'\">\n"
+          "    <xacro:if value=\"${collision_meshes == 'hull' and mesh_file in"
+          " baked_collision_meshes}\">\n"
+          "      <mesh filename=\"package://" << package << "/meshes/"
+          "${mesh_file[:mesh_file.rfind('.')]}_collision.stl\"\n"
+          "        scale=\"${scale}\" />\n"
+          "    </xacro:if>\n"
+          "    <xacro:unless value=\"${collision_meshes == 'hull' and mesh_file"
+          " in baked_collision_meshes}\">\n"
+          "      <mesh filename=\"package://" << package << "/meshes/"
+          "${mesh_file}\"\n"
+          "        scale=\"${scale}\" />\n"
+          "    </xacro:unless>\n"
+          "  </xacro:macro>\n"
+          "</robot>\n";
+  if (!file) throw std::runtime_error("error writing " + path);
+}
+
+std::string BaseName(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string Directory(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+std::string Stem(const std::string& name) {
+  size_t dot = name.rfind('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+bool NewerThan(const std::string& target, const std::string& source) {
+  struct stat target_stat, source_stat;
+  if (stat(target.c_str(), &target_stat) != 0) return false;
+  if (stat(source.c_str(), &source_stat) != 0) return false;
+  return target_stat.st_mtime >= source_stat.st_mtime;
+}
+
+void Usage() {
+  std::cerr <<
+      "Usage: collision_mesh_baker [options] mesh.dae...\n"
+      "  --output-dir DIR    write <name>_collision.stl to DIR"
+      " (default: next to the mesh)\n"
+      "  --max-vertices N    vertices per hull, 0 keeps the exact hull"
+      " (default 64)\n"
+      "  --tolerance D       stop reducing once the hull is within D meters"
+      " (default 0)\n"
+      "  --merge             one hull for the whole mesh instead of one per"
+      " geometry\n"
+      "  --xacro FILE        write the collision_mesh xacro macro for the"
+      " baked meshes\n"
+      "  --package NAME      package of the meshes in the xacro"
+      " (default mmuav_description)\n"
+      "  --force             bake even if the STL is newer than the mesh\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string output_dir, xacro, package = "mmuav_description";
+  int max_vertices = 64;
+  double tolerance = 0.0;
+  bool merge = false, force = false;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--output-dir" && has_value) output_dir = argv[++i];
+    else if (arg == "--max-vertices" && has_value) max_vertices = atoi(argv[++i]);
+    else if (arg == "--tolerance" && has_value) tolerance = atof(argv[++i]);
+    else if (arg == "--xacro" && has_value) xacro = argv[++i];
+    else if (arg == "--package" && has_value) package = argv[++i];
+    else if (arg == "--merge") merge = true;
+    else if (arg == "--force") force = true;
+    else if (arg == "-h" || arg == "--help") { Usage(); return 0; }
+    else if (!arg.empty() && arg[0] == '-') { Usage(); return 2; }
+    else inputs.push_back(arg);
+  }
+  if (inputs.empty() || (max_vertices != 0 && max_vertices < 4)) {
+    Usage();
+    return 2;
+  }
+
+  std::vector<std::string> baked;
+  int failures = 0;
+  for (const std::string& input : inputs) {
+    std::string name = BaseName(input);
+    std::string output = (output_dir.empty() ? Directory(input) : output_dir) +
+                         "/" + Stem(name) + "_collision.stl";
+    if (!force && NewerThan(output, input)) {
+      std::cout << name << ": up to date" << std::endl;
+      baked.push_back(name);
+      continue;
+    }
+
+    try {
+      ColladaMesh mesh;
+      mesh.Load(input);
+      if (merge && mesh.instances.size() > 1) {
+        for (size_t i = 1; i < mesh.instances.size(); i++)
+          mesh.instances[0].insert(mesh.instances[0].end(),
+                                   mesh.instances[i].begin(),
+                                   mesh.instances[i].end());
+        mesh.instances.resize(1);
+      }
+
+      std::vector<Triangle> triangles;
+      int points = 0, hulls = 0;
+      double error = 0.0, size = 0.0;
+      for (const auto& instance : mesh.instances) {
+        HullResult result;
+        points += int(instance.size());
+        if (!BakeHull(instance, max_vertices, tolerance, triangles, result)) {
+          std::cerr << name << ": skipping a flat geometry with "
+                    << instance.size() << " points" << std::endl;
+          continue;
+        }
+        hulls++;
+        error = std::max(error, result.error);
+        size = std::max(size, result.size);
+      }
+      if (triangles.empty()) throw std::runtime_error("no solid geometry");
+
+      WriteStl(output, name, triangles);
+      baked.push_back(name);
+      std::cout << name << ": " << points << " points -> " << hulls
+                << " hull(s), " << triangles.size() << " triangles, max error "
+                << error * 1000.0 << " mm (" << 100.0 * error / size
+                << " % of the size)" << std::endl;
+    } catch (const std::exception& e) {
+      std::cerr << name << ": " << e.what() << std::endl;
+      failures++;
+    }
+  }
+
+  if (!xacro.empty()) {
+    try {
+      WriteXacro(xacro, baked, package);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+  return failures ? 1 : 0;
+}
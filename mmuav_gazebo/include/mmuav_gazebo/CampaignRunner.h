@@ -0,0 +1,107 @@
+/******************************************************************************
+File name: CampaignRunner.h
+Description: Runs a Monte Carlo campaign of headless simulation trials. Every
+    trial is a roslaunch of a trial launch file with sampled launch
+    arguments, started in its own process group with its own ROS master and
+    Gazebo master port. Trials write their metrics to a file, the runner
+    collects them into one CSV table with a column per parameter and metric.
+******************************************************************************/
+#ifndef MMUAV_GAZEBO_CAMPAIGN_RUNNER_H
+#define MMUAV_GAZEBO_CAMPAIGN_RUNNER_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Parameter sampled per run and passed to the launch file as name:=value.
+//   uniform lo hi, loguniform lo hi, normal mean deviation, choice v1 v2 ...
+struct CampaignParameter
+{
+    std::string name;
+    std::string distribution;
+    std::vector<double> arguments;
+    std::vector<std::string> choices;
+};
+
+// Campaign file, one setting per line, # starts a comment:
+//   launch <package> <file>     trial launch file
+//   runs <n>                    number of trials
+//   seed <n>                    campaign seed
+//   jobs <n>                    trials in parallel, 0 - half the cores
+//   timeout <s>                 wall time limit of one trial
+//   base_port <port>            first of the 2*jobs ports used
+//   output <file>               CSV table of the results
+//   work_dir <dir>              run directories with logs and metrics
+//   arg <name> <value>          launch argument of every trial
+//   sample <name> <distribution> <arguments>
+struct CampaignConfig
+{
+    std::string launchPackage, launchFile;
+    std::vector<std::pair<std::string, std::string> > fixedArguments;
+    std::vector<CampaignParameter> parameters;
+    int runs;
+    uint64_t seed;
+    int jobs;
+    double timeout;
+    int basePort;
+    std::string output;
+    std::string workDir;
+
+    CampaignConfig();
+    bool load(const std::string &path, std::string &error);
+};
+
+struct RunResult
+{
+    int run;
+    uint64_t seed;
+    std::string status;
+    double wallTime;
+    std::vector<std::string> values;
+    std::vector<std::pair<std::string, std::string> > metrics;
+};
+
+class CampaignRunner
+{
+public:
+    explicit CampaignRunner(const CampaignConfig &config);
+
+    // Runs all trials and writes the table, returns the number of trials
+    // that did not finish with metrics. The table is rewritten after every
+    // trial, so a stopped campaign keeps its results.
+    int run();
+    // Stops the running trials, safe to call from a signal handler.
+    void stop() { stopping = 1; }
+
+    // Seed and parameter values of a run depend only on the campaign seed
+    // and the run index, not on the scheduling or the platform.
+    static uint64_t runSeed(uint64_t campaignSeed, int run);
+    std::vector<std::string> sample(uint64_t seed) const;
+
+private:
+    struct Slot
+    {
+        pid_t pid;
+        int run;
+        double start;
+        double terminated;
+        std::string directory;
+        RunResult result;
+    };
+
+    CampaignConfig config;
+    std::vector<RunResult> results;
+    volatile sig_atomic_t stopping;
+
+    bool startRun(Slot &slot, int slotIndex, int run);
+    bool pollRun(Slot &slot, double now);
+    void terminateRun(Slot &slot, double now);
+    void readMetrics(const std::string &path, RunResult &result) const;
+    void writeResults() const;
+};
+
+#endif // MMUAV_GAZEBO_CAMPAIGN_RUNNER_H
@@ -0,0 +1,444 @@
+/******************************************************************************
+File name: CampaignRunner.cpp
+Description: Runs a Monte Carlo campaign of headless simulation trials.
+******************************************************************************/
+
+#include <mmuav_gazebo/CampaignRunner.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+
+// splitmix64, the same sequence on every platform unlike the standard
+// library distributions.
+class Random
+{
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // In (0, 1)
+    double uniform() { return (double(next() >> 11) + 0.5)/9007199254740992.0; }
+
+    double normal()
+    {
+        double u1 = uniform(), u2 = uniform();
+        return std::sqrt(-2.0*std::log(u1))*std::cos(2.0*M_PI*u2);
+    }
+
+private:
+    uint64_t state;
+};
+
+double wallTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return double(now.tv_sec) + 1e-9*double(now.tv_nsec);
+}
+
+std::string formatValue(double value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.10g", value);
+    return buffer;
+}
+
+bool makeDirectories(const std::string &path)
+{
+    for (size_t i = 1; i <= path.size(); i++)
+    {
+        if (i < path.size() && path[i] != '/') continue;
+        std::string prefix = path.substr(0, i);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+std::string csvField(const std::string &value)
+{
+    if (value.find_first_of(",\"\n") == std::string::npos) return value;
+    std::string quoted = "\"";
+    for (size_t i = 0; i < value.size(); i++)
+    {
+        if (value[i] == '"') quoted += '"';
+        quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+}
+
+CampaignConfig::CampaignConfig() :
+    runs(1), seed(0), jobs(0), timeout(600.0), basePort(11411),
+    output("campaign.csv"), workDir("campaign_runs")
+{
+}
+
+bool CampaignConfig::load(const std::string &path, std::string &error)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    for (int number = 1; std::getline(file, line); number++)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string key;
+        if (!(tokens >> key)) continue;
+
+        std::ostringstream where;
+        where << path << ":" << number << ": ";
+        bool ok = true;
+        if (key == "launch") ok = bool(tokens >> launchPackage >> launchFile);
+        else if (key == "runs") ok = bool(tokens >> runs) && runs > 0;
+        else if (key == "seed") ok = bool(tokens >> seed);
+        else if (key == "jobs") ok = bool(tokens >> jobs) && jobs >= 0;
+        else if (key == "timeout") ok = bool(tokens >> timeout) && timeout > 0.0;
+        else if (key == "base_port") ok = bool(tokens >> basePort) && basePort > 0;
+        else if (key == "output") ok = bool(tokens >> output);
+        else if (key == "work_dir") ok = bool(tokens >> workDir);
+        else if (key == "arg")
+        {
+            std::string name, value;
+            ok = bool(tokens >> name >> value);
+            fixedArguments.push_back(std::make_pair(name, value));
+        }
+        else if (key == "sample")
+        {
+            CampaignParameter parameter;
+            ok = bool(tokens >> parameter.name >> parameter.distribution);
+            std::string value;
+            while (ok && tokens >> value)
+            {
+                parameter.choices.push_back(value);
+                char *end;
+                double number = strtod(value.c_str(), &end);
+                if (parameter.distribution != "choice" && *end != '\0')
+                {
+                    error = where.str() + "not a number: " + value;
+                    return false;
+                }
+                parameter.arguments.push_back(number);
+            }
+            const std::string &distribution = parameter.distribution;
+            if (distribution == "uniform" || distribution == "normal")
+                ok = ok && parameter.arguments.size() == 2;
+            else if (distribution == "loguniform")
+                ok = ok && parameter.arguments.size() == 2 &&
+                    parameter.arguments[0] > 0.0 && parameter.arguments[1] > 0.0;
+            else if (distribution == "choice")
+                ok = ok && !parameter.choices.empty();
+            else
+            {
+                error = where.str() + "unknown distribution " + distribution;
+                return false;
+            }
+            parameters.push_back(parameter);
+        }
+        else
+        {
+            error = where.str() + "unknown setting " + key;
+            return false;
+        }
+
+        if (!ok)
+        {
+            error = where.str() + "invalid " + key;
+            return false;
+        }
+    }
+
+    if (launchFile.empty())
+    {
+        error = path + ": no launch file";
+        return false;
+    }
+    return true;
+}
+
+CampaignRunner::CampaignRunner(const CampaignConfig &config) :
+    config(config), stopping(0)
+{
+    if (this->config.jobs <= 0)
+        this->config.jobs = std::max(1, int(std::thread::hardware_concurrency())/2);
+}
+
+uint64_t CampaignRunner::runSeed(uint64_t campaignSeed, int run)
+{
+    Random random(campaignSeed ^ (uint64_t(run) << 32));
+    random.next();
+    return random.next() & 0x7fffffffULL;
+}
+
+std::vector<std::string> CampaignRunner::sample(uint64_t seed) const
+{
+    // Every parameter draws from its own stream, adding a parameter to the
+    // campaign does not change the values of the others.
+    std::vector<std::string> values;
+    for (size_t i = 0; i < config.parameters.size(); i++)
+    {
+        const CampaignParameter &parameter = config.parameters[i];
+        Random random(seed*1000003ULL + i);
+        const std::vector<double> &a = parameter.arguments;
+        if (parameter.distribution == "uniform")
+            values.push_back(formatValue(a[0] + (a[1] - a[0])*random.uniform()));
+        else if (parameter.distribution == "loguniform")
+            values.push_back(formatValue(a[0]*std::exp(std::log(a[1]/a[0])*random.uniform())));
+        else if (parameter.distribution == "normal")
+            values.push_back(formatValue(a[0] + a[1]*random.normal()));
+        else
+            values.push_back(parameter.choices[random.next() % parameter.choices.size()]);
+    }
+    return values;
+}
+
+int CampaignRunner::run()
+{
+    if (!makeDirectories(config.workDir))
+    {
+        std::cerr << "Cannot create " << config.workDir << ": " << strerror(errno) << std::endl;
+        return config.runs;
+    }
+
+    std::vector<Slot> slots(config.jobs);
+    for (size_t i = 0; i < slots.size(); i++) slots[i].pid = 0;
+
+    int nextRun = 0, active = 0;
+    while (active > 0 || (nextRun < config.runs && !stopping))
+    {
+        double now = wallTime();
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (slots[i].pid != 0)
+            {
+                if (stopping || now - slots[i].start > config.timeout)
+                    terminateRun(slots[i], now);
+                if (!pollRun(slots[i], now)) continue;
+                active--;
+                writeResults();
+            }
+            if (nextRun < config.runs && !stopping)
+            {
+                if (startRun(slots[i], int(i), nextRun)) active++;
+                else writeResults();
+                nextRun++;
+            }
+        }
+        usleep(100000);
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < results.size(); i++)
+        if (results[i].status != "ok") failed++;
+    return failed + (config.runs - int(results.size()));
+}
+
+bool CampaignRunner::startRun(Slot &slot, int slotIndex, int run)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "run_%05d", run);
+    slot.directory = config.workDir + "/" + name;
+    slot.run = run;
+    slot.start = wallTime();
+    slot.terminated = 0.0;
+    slot.result = RunResult();
+    slot.result.run = run;
+    slot.result.seed = runSeed(config.seed, run);
+    slot.result.values = sample(slot.result.seed);
+    slot.result.wallTime = 0.0;
+
+    std::string metricsFile = slot.directory + "/metrics.csv";
+    unlink(metricsFile.c_str());
+    if (!makeDirectories(slot.directory))
+    {
+        slot.result.status = "failed";
+        results.push_back(slot.result);
+        return false;
+    }
+
+    std::vector<std::string> arguments;
+    arguments.push_back("roslaunch");
+    arguments.push_back("-p");
+    arguments.push_back(formatValue(config.basePort + 2*slotIndex));
+    arguments.push_back(config.launchPackage);
+    arguments.push_back(config.launchFile);
+    for (size_t i = 0; i < config.fixedArguments.size(); i++)
+        arguments.push_back(config.fixedArguments[i].first + ":=" + config.fixedArguments[i].second);
+    for (size_t i = 0; i < config.parameters.size(); i++)
+        arguments.push_back(config.parameters[i].name + ":=" + slot.result.values[i]);
+    arguments.push_back("seed:=" + formatValue(double(slot.result.seed)));
+    arguments.push_back("metrics_file:=" + metricsFile);
+
+    std::ostringstream rosMaster, gazeboMaster;
+    rosMaster << "http://localhost:" << config.basePort + 2*slotIndex;
+    gazeboMaster << "http://localhost:" << config.basePort + 2*slotIndex + 1;
+    std::string logFile = slot.directory + "/roslaunch.log";
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Own process group, so a timeout takes down gzserver and the
+        // nodes along with roslaunch.
+        setpgid(0, 0);
+        setenv("ROS_MASTER_URI", rosMaster.str().c_str(), 1);
+        setenv("GAZEBO_MASTER_URI", gazeboMaster.str().c_str(), 1);
+        setenv("ROS_HOME", slot.directory.c_str(), 1);
+        setenv("ROS_LOG_DIR", (slot.directory + "/log").c_str(), 1);
+        int log = open(logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log >= 0)
+        {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(log);
+        }
+        int input = open("/dev/null", O_RDONLY);
+        if (input >= 0) dup2(input, STDIN_FILENO);
+
+        std::vector<char *> argv;
+        for (size_t i = 0; i < arguments.size(); i++)
+            argv.push_back(const_cast<char *>(arguments[i].c_str()));
+        argv.push_back(NULL);
+        execvp(argv[0], &argv[0]);
+        perror("execvp roslaunch");
+        _exit(127);
+    }
+    if (pid < 0)
+    {
+        std::cerr << "fork failed: " << strerror(errno) << std::endl;
+        slot.result.status = "failed";
+        results.push_back(slot.result);
+        return false;
+    }
+
+    setpgid(pid, pid);
+    slot.pid = pid;
+    std::cout << "run " << run << " started, seed " << slot.result.seed
+        << ", ports " << config.basePort + 2*slotIndex << "/"
+        << config.basePort + 2*slotIndex + 1 << std::endl;
+    return true;
+}
+
+void CampaignRunner::terminateRun(Slot &slot, double now)
+{
+    if (slot.terminated == 0.0)
+    {
+        slot.terminated = now;
+        slot.result.status = stopping ? "stopped" : "timeout";
+        kill(-slot.pid, SIGINT);
+    }
+    else if (now - slot.terminated > 15.0)
+    {
+        kill(-slot.pid, SIGKILL);
+    }
+}
+
+bool CampaignRunner::pollRun(Slot &slot, double now)
+{
+    int status;
+    pid_t pid = waitpid(slot.pid, &status, WNOHANG);
+    if (pid == 0) return false;
+
+    // roslaunch is gone, make sure no node of the group outlives it
+    kill(-slot.pid, SIGKILL);
+    slot.pid = 0;
+    slot.result.wallTime = now - slot.start;
+    readMetrics(slot.directory + "/metrics.csv", slot.result);
+    if (slot.result.status.empty())
+        slot.result.status = slot.result.metrics.empty() ? "failed" : "ok";
+    results.push_back(slot.result);
+    std::cout << "run " << slot.run << " " << slot.result.status << " after "
+        << slot.result.wallTime << " s" << std::endl;
+    return true;
+}
+
+void CampaignRunner::readMetrics(const std::string &path, RunResult &result) const
+{
+    // name,value per line
+    std::ifstream file(path.c_str());
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t comma = line.find(',');
+        if (comma == std::string::npos) continue;
+        result.metrics.push_back(std::make_pair(line.substr(0, comma), line.substr(comma + 1)));
+    }
+}
+
+void CampaignRunner::writeResults() const
+{
+    // Metric columns in order of first appearance over the runs
+    std::vector<std::string> metricNames;
+    std::map<std::string, size_t> metricColumns;
+    std::vector<const RunResult *> sorted;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        sorted.push_back(&results[i]);
+        for (size_t j = 0; j < results[i].metrics.size(); j++)
+        {
+            const std::string &name = results[i].metrics[j].first;
+            if (metricColumns.count(name)) continue;
+            metricColumns[name] = metricNames.size();
+            metricNames.push_back(name);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(),
+        [](const RunResult *a, const RunResult *b) { return a->run < b->run; });
+
+    std::string temporary = config.output + ".tmp";
+    std::ofstream file(temporary.c_str());
+    file << "run,seed,status,wall_time";
+    for (size_t i = 0; i < config.parameters.size(); i++)
+        file << "," << csvField(config.parameters[i].name);
+    for (size_t i = 0; i < metricNames.size(); i++)
+        file << "," << csvField(metricNames[i]);
+    file << "\n";
+
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        const RunResult &result = *sorted[i];
+        file << result.run << "," << result.seed << "," << result.status << ","
+            << formatValue(result.wallTime);
+        for (size_t j = 0; j < result.values.size(); j++)
+            file << "," << csvField(result.values[j]);
+        std::vector<std::string> metrics(metricNames.size());
+        for (size_t j = 0; j < result.metrics.size(); j++)
+            metrics[metricColumns[result.metrics[j].first]] = result.metrics[j].second;
+        for (size_t j = 0; j < metrics.size(); j++)
+            file << "," << csvField(metrics[j]);
+        file << "\n";
+    }
+    file.close();
+    if (rename(temporary.c_str(), config.output.c_str()) != 0)
+        std::cerr << "Cannot write " << config.output << ": " << strerror(errno) << std::endl;
+}
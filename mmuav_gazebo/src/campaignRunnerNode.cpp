@@ -0,0 +1,83 @@
+/******************************************************************************
+File name: campaignRunnerNode.cpp
+Description: Command line front end of the CampaignRunner.
+    campaignRunnerNode <campaign file> [--runs n] [--jobs n] [--seed n]
+        [--output file] [--dry-run]
+    --dry-run prints the seed and parameter values of every run without
+    starting anything.
+******************************************************************************/
+
+#include <mmuav_gazebo/CampaignRunner.h>
+
+#include <signal.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+CampaignRunner *runner = NULL;
+
+void stopHandler(int signal)
+{
+    if (runner) runner->stop();
+}
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <campaign file> [--runs n] [--jobs n]"
+            " [--seed n] [--output file] [--dry-run]" << std::endl;
+        return 2;
+    }
+
+    CampaignConfig config;
+    std::string error;
+    if (!config.load(argv[1], error))
+    {
+        std::cerr << error << std::endl;
+        return 2;
+    }
+
+    bool dryRun = false;
+    for (int i = 2; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--dry-run")) dryRun = true;
+        else if (!strcmp(argv[i], "--runs") && hasValue) config.runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--jobs") && hasValue) config.jobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) config.seed = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--output") && hasValue) config.output = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    CampaignRunner campaign(config);
+    if (dryRun)
+    {
+        for (int run = 0; run < config.runs; run++)
+        {
+            uint64_t seed = CampaignRunner::runSeed(config.seed, run);
+            std::vector<std::string> values = campaign.sample(seed);
+            std::cout << run << " seed " << seed;
+            for (size_t i = 0; i < values.size(); i++)
+                std::cout << " " << config.parameters[i].name << ":=" << values[i];
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+
+    runner = &campaign;
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+    int failed = campaign.run();
+    std::cout << failed << " of " << config.runs << " runs without metrics, results in "
+        << config.output << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+/******************************************************************************
+File name: trialMetricsNode.cpp
+Description: Drives one campaign trial: scales the mass of the vehicle body,
+    publishes a constant wind to the motor models and records tracking
+    metrics from the pose of the vehicle. After duration seconds of
+    simulation time the metrics are written as name,value lines and the node
+    exits, which ends the trial launch (the node is required there).
+    Gains under ~expected/<controller>/<name> are compared with the
+    configurations the controllers report, a trial whose controllers did
+    not fly the sampled gains fails.
+******************************************************************************/
+
+#include <ros/ros.h>
+#include <dynamic_reconfigure/Config.h>
+#include <gazebo_msgs/GetLinkProperties.h>
+#include <gazebo_msgs/SetLinkProperties.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/Vector3.h>
+#include <rotors_comm/WindSpeed.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <boost/bind.hpp>
+
+class TrialMetrics
+{
+public:
+    TrialMetrics() : nhParams("~"), samples(0), settled(false),
+        referenceReceived(false), crashed(false)
+    {
+        nhParams.param("duration", duration, double(30.0));
+        // Transient after the start that is not part of the metrics
+        nhParams.param("settle_time", settleTime, double(5.0));
+        nhParams.param("crash_height", crashHeight, double(0.1));
+        nhParams.param("output", output, std::string("metrics.csv"));
+        nhParams.param("link", link, std::string("base_link"));
+        nhParams.param("mass_scale", massScale, double(1.0));
+        nhParams.param("wind_x", wind.x, double(0.0));
+        nhParams.param("wind_y", wind.y, double(0.0));
+        nhParams.param("wind_z", wind.z, double(0.0));
+        // Topic the motor models read the wind from, they have no robot
+        // namespace and listen on the global default
+        nhParams.param("wind_topic", windTopic, std::string("/gazebo/wind_speed"));
+
+        sumZError2 = maxZError = sumDrift2 = maxDrift = sumTilt2 = maxTilt = 0.0;
+        lastZ = 0.0;
+
+        poseSub = nhTopics.subscribe("pose", 1, &TrialMetrics::poseCallback, this);
+        referenceSub = nhTopics.subscribe("pos_ref", 1, &TrialMetrics::referenceCallback, this);
+        windPub = nhTopics.advertise<rotors_comm::WindSpeed>(windTopic, 1);
+
+        XmlRpc::XmlRpcValue expected;
+        if (nhParams.getParam("expected", expected) &&
+            expected.getType() == XmlRpc::XmlRpcValue::TypeStruct)
+        {
+            for (XmlRpc::XmlRpcValue::iterator controller = expected.begin();
+                controller != expected.end(); ++controller)
+            {
+                ControllerGains &gains = expectedGains[controller->first];
+                for (XmlRpc::XmlRpcValue::iterator gain = controller->second.begin();
+                    gain != controller->second.end(); ++gain)
+                {
+                    gains.values[gain->first] = gain->second.getType() ==
+                        XmlRpc::XmlRpcValue::TypeInt ? double(int(gain->second)) :
+                        double(gain->second);
+                }
+                gains.reported = gains.matched = false;
+                gains.sub = nhTopics.subscribe<dynamic_reconfigure::Config>(
+                    controller->first + "/parameter_updates", 1,
+                    boost::bind(&TrialMetrics::configCallback, this,
+                    controller->first, _1));
+            }
+        }
+    }
+
+    int run()
+    {
+        if (massScale != 1.0 && !scaleMass()) return 1;
+
+        ros::Rate rate(10.0);
+        while (ros::ok())
+        {
+            rotors_comm::WindSpeed windMsg;
+            windMsg.header.stamp = ros::Time::now();
+            windMsg.velocity = wind;
+            windPub.publish(windMsg);
+
+            ros::spinOnce();
+            if (!ros::Time::now().isZero() && ros::Time::now().toSec() >= duration) break;
+            rate.sleep();
+        }
+        if (!gainsApplied()) return 1;
+        if (!windDelivered())
+        {
+            ROS_ERROR("Nothing subscribes to the wind on %s, the trial did not "
+                "have the sampled wind.", windPub.getTopic().c_str());
+            return 1;
+        }
+        return writeMetrics() ? 0 : 1;
+    }
+
+private:
+    // Gains a controller has to report through dynamic reconfigure
+    struct ControllerGains
+    {
+        std::map<std::string, double> values;
+        ros::Subscriber sub;
+        bool reported, matched;
+    };
+
+    ros::NodeHandle nhParams, nhTopics;
+    ros::Subscriber poseSub, referenceSub;
+    ros::Publisher windPub;
+
+    double duration, settleTime, crashHeight, massScale;
+    std::string output, link, windTopic;
+    geometry_msgs::Vector3 wind;
+    std::map<std::string, ControllerGains> expectedGains;
+
+    unsigned long samples;
+    bool settled, referenceReceived, crashed;
+    double referenceZ, startX, startY, lastZ;
+    double sumZError2, maxZError, sumDrift2, maxDrift, sumTilt2, maxTilt;
+
+    // Mass and inertia of the body link times mass_scale, the center of
+    // mass stays.
+    bool scaleMass()
+    {
+        std::string scopedLink = ros::this_node::getNamespace().substr(1) + "::" + link;
+        ros::service::waitForService("/gazebo/get_link_properties");
+        gazebo_msgs::GetLinkProperties get;
+        get.request.link_name = scopedLink;
+        if (!ros::service::call("/gazebo/get_link_properties", get) || !get.response.success)
+        {
+            ROS_ERROR("Cannot get the properties of %s.", scopedLink.c_str());
+            return false;
+        }
+        gazebo_msgs::SetLinkProperties set;
+        set.request.link_name = scopedLink;
+        set.request.com = get.response.com;
+        set.request.gravity_mode = get.response.gravity_mode;
+        set.request.mass = get.response.mass*massScale;
+        set.request.ixx = get.response.ixx*massScale;
+        set.request.ixy = get.response.ixy*massScale;
+        set.request.ixz = get.response.ixz*massScale;
+        set.request.iyy = get.response.iyy*massScale;
+        set.request.iyz = get.response.iyz*massScale;
+        set.request.izz = get.response.izz*massScale;
+        if (!ros::service::call("/gazebo/set_link_properties", set) || !set.response.success)
+        {
+            ROS_ERROR("Cannot set the properties of %s.", scopedLink.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void configCallback(const std::string &controller,
+        const dynamic_reconfigure::ConfigConstPtr &msg)
+    {
+        ControllerGains &gains = expectedGains[controller];
+        gains.reported = true;
+        gains.matched = true;
+        for (std::map<std::string, double>::const_iterator it = gains.values.begin();
+            it != gains.values.end(); ++it)
+        {
+            bool found = false;
+            for (size_t i = 0; i < msg->doubles.size(); i++)
+            {
+                if (msg->doubles[i].name != it->first) continue;
+                found = true;
+                double value = msg->doubles[i].value;
+                if (std::abs(value - it->second) > 1e-9*std::max(1.0, std::abs(it->second)))
+                {
+                    ROS_ERROR("%s uses %s = %g, the trial sampled %g.", controller.c_str(),
+                        it->first.c_str(), value, it->second);
+                    gains.matched = false;
+                }
+            }
+            if (!found)
+            {
+                ROS_ERROR("%s has no gain %s.", controller.c_str(), it->first.c_str());
+                gains.matched = false;
+            }
+        }
+    }
+
+    // Every controller has reported a configuration with the expected gains,
+    // the last one counts
+    bool gainsApplied() const
+    {
+        bool applied = true;
+        for (std::map<std::string, ControllerGains>::const_iterator it = expectedGains.begin();
+            it != expectedGains.end(); ++it)
+        {
+            if (!it->second.reported)
+                ROS_ERROR("%s did not report its gains.", it->first.c_str());
+            applied = applied && it->second.reported && it->second.matched;
+        }
+        return applied;
+    }
+
+    // A sampled wind without a motor model listening would silently give a
+    // trial in calm air
+    bool windDelivered() const
+    {
+        if (wind.x == 0.0 && wind.y == 0.0 && wind.z == 0.0) return true;
+        return windPub.getNumSubscribers() > 0;
+    }
+
+    void referenceCallback(const geometry_msgs::Vector3 &msg)
+    {
+        referenceZ = msg.z;
+        referenceReceived = true;
+    }
+
+    void poseCallback(const geometry_msgs::PoseStamped &msg)
+    {
+        const geometry_msgs::Point &p = msg.pose.position;
+        const geometry_msgs::Quaternion &q = msg.pose.orientation;
+        lastZ = p.z;
+        if (msg.header.stamp.toSec() < settleTime) return;
+        if (!settled)
+        {
+            settled = true;
+            startX = p.x;
+            startY = p.y;
+            if (!referenceReceived) referenceZ = p.z;
+        }
+
+        // Angle between the body z axis and the world z axis
+        double cosTilt = 1.0 - 2.0*(q.x*q.x + q.y*q.y);
+        double tilt = std::acos(std::max(-1.0, std::min(1.0, cosTilt)));
+        double zError = std::abs(p.z - referenceZ);
+        double drift = std::hypot(p.x - startX, p.y - startY);
+
+        samples++;
+        sumZError2 += zError*zError;
+        sumDrift2 += drift*drift;
+        sumTilt2 += tilt*tilt;
+        maxZError = std::max(maxZError, zError);
+        maxDrift = std::max(maxDrift, drift);
+        maxTilt = std::max(maxTilt, tilt);
+        if (p.z < crashHeight) crashed = true;
+    }
+
+    bool writeMetrics()
+    {
+        if (samples == 0)
+        {
+            ROS_ERROR("No pose received after the settle time, no metrics written.");
+            return false;
+        }
+        std::ofstream file(output.c_str());
+        file << "samples," << samples << "\n";
+        file << "rms_z_error," << std::sqrt(sumZError2/samples) << "\n";
+        file << "max_z_error," << maxZError << "\n";
+        file << "rms_xy_drift," << std::sqrt(sumDrift2/samples) << "\n";
+        file << "max_xy_drift," << maxDrift << "\n";
+        file << "rms_tilt," << std::sqrt(sumTilt2/samples) << "\n";
+        file << "max_tilt," << maxTilt << "\n";
+        file << "final_z," << lastZ << "\n";
+        file << "crashed," << (crashed ? 1 : 0) << "\n";
+        return bool(file);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "trial_metrics");
+    TrialMetrics metrics;
+    return metrics.run();
+}
@@ -0,0 +1,175 @@
+/*
+ * Reduced order cable model: a chain of point masses connected by axial
+ * spring-dampers that only carry tension. Both ends are attached to
+ * externally moving points (the UAV and the load), the model returns the
+ * averaged force the cable exerts on each of them.
+ *
+ * The chain is integrated with semi-implicit Euler in substeps small enough
+ * for the segment stiffness, so the physics engine step doesn't depend on
+ * the cable parameters.
+ */
+
+#ifndef MMUAV_PLUGINS_CABLE_MODEL_H
+#define MMUAV_PLUGINS_CABLE_MODEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace gazebo {
+
+class CableModel {
+ public:
+  struct Parameters {
+    double length;             // [m]
+    double mass;               // [kg]
+    int segments;
+    double stiffness;          // axial stiffness EA [N]
+    double damping;            // axial damping per unit strain rate [N s]
+    double lateral_damping;    // velocity damping of the nodes [1/s]
+    Eigen::Vector3d gravity;   // [m/s^2]
+
+    Parameters()
+        : length(1.0),
+          mass(0.025),
+          segments(10),
+          stiffness(500.0),
+          damping(2.0),
+          lateral_damping(0.5),
+          gravity(0.0, 0.0, -9.81) {}
+  };
+
+  CableModel() : node_mass_(0.0), rest_length_(0.0), segment_stiffness_(0.0),
+                 segment_damping_(0.0), max_step_(0.0) {}
+
+  void Configure(const Parameters& params) {
+    params_ = params;
+    params_.segments = std::max(1, params_.segments);
+    rest_length_ = params_.length / params_.segments;
+    segment_stiffness_ = params_.stiffness / rest_length_;
+    // Endpoint nodes belong to the links, their share of the mass is
+    // neglected.
+    node_mass_ = params_.mass / params_.segments;
+    segment_damping_ = params_.damping / rest_length_;
+
+    // Highest chain eigenfrequency is below 2 sqrt(k / m), keep the
+    // substep well inside the stability region of semi-implicit Euler,
+    // for both the springs and the dampers.
+    double omega = 2.0 * std::sqrt(segment_stiffness_ / node_mass_);
+    max_step_ = std::min(0.5 / omega,
+                         0.5 * node_mass_ / std::max(segment_damping_, 1e-9));
+  }
+
+  const Parameters& GetParameters() const { return params_; }
+
+  // Substeps needed to advance the cable by dt
+  int Substeps(double dt) const {
+    return std::max(1, int(std::ceil(dt / max_step_)));
+  }
+
+  // Lays the cable out on the straight line between the end points
+  void Reset(const Eigen::Vector3d& start, const Eigen::Vector3d& end) {
+    int n = params_.segments;
+    position_.resize(n + 1);
+    velocity_.assign(n + 1, Eigen::Vector3d::Zero());
+    for (int i = 0; i <= n; i++)
+      position_[i] = start + (end - start) * (double(i) / n);
+    tension_.assign(n, 0.0);
+  }
+
+  bool Initialized() const { return !position_.empty(); }
+  void Clear() { position_.clear(); }
+
+  // Advances the cable by dt. The end points move linearly from their
+  // previous positions to start and end with the given velocities.
+  // start_force and end_force are the average cable forces on the ends.
+  void Step(double dt, int max_substeps,
+            const Eigen::Vector3d& start, const Eigen::Vector3d& start_vel,
+            const Eigen::Vector3d& end, const Eigen::Vector3d& end_vel,
+            Eigen::Vector3d* start_force, Eigen::Vector3d* end_force) {
+    int n = params_.segments;
+    int substeps = std::min(Substeps(dt), std::max(1, max_substeps));
+    double h = dt / substeps;
+    Eigen::Vector3d start_begin = position_[0];
+    Eigen::Vector3d end_begin = position_[n];
+
+    force_.resize(n + 1);
+    direction_.assign(n, Eigen::Vector3d::Zero());
+    start_force->setZero();
+    end_force->setZero();
+    for (int s = 1; s <= substeps; s++) {
+      double alpha = double(s) / substeps;
+      position_[0] = start_begin + (start - start_begin) * alpha;
+      position_[n] = end_begin + (end - end_begin) * alpha;
+      velocity_[0] = start_vel;
+      velocity_[n] = end_vel;
+
+      for (int i = 0; i <= n; i++)
+        force_[i] = node_mass_ * (params_.gravity -
+                                  params_.lateral_damping * velocity_[i]);
+      for (int i = 0; i < n; i++) {
+        Eigen::Vector3d delta = position_[i + 1] - position_[i];
+        double distance = delta.norm();
+        double tension = 0.0;
+        if (distance > rest_length_) {
+          Eigen::Vector3d direction = delta / distance;
+          double stretch_rate = direction.dot(velocity_[i + 1] - velocity_[i]);
+          // A slack cable pushes nothing, damping can't either
+          tension = std::max(0.0, segment_stiffness_ * (distance - rest_length_) +
+                                  segment_damping_ * stretch_rate);
+          force_[i] += tension * direction;
+          force_[i + 1] -= tension * direction;
+          direction_[i] = direction;
+        }
+        tension_[i] = tension;
+      }
+
+      // Only the cable's pull acts on the links, not its weight share
+      *start_force += tension_[0] * direction_[0];
+      *end_force -= tension_[n - 1] * direction_[n - 1];
+
+      for (int i = 1; i < n; i++) {
+        velocity_[i] += force_[i] * (h / node_mass_);
+        position_[i] += velocity_[i] * h;
+      }
+    }
+    *start_force /= substeps;
+    *end_force /= substeps;
+  }
+
+  const std::vector<Eigen::Vector3d>& Positions() const { return position_; }
+  const std::vector<Eigen::Vector3d>& Velocities() const { return velocity_; }
+
+  // Replaces the node states, e.g. from a snapshot. False if the number of
+  // nodes does not match the segments, the cable is unchanged then.
+  bool SetState(const std::vector<Eigen::Vector3d>& position,
+                const std::vector<Eigen::Vector3d>& velocity) {
+    size_t nodes = size_t(params_.segments + 1);
+    if (position.size() != nodes || velocity.size() != nodes) return false;
+    position_ = position;
+    velocity_ = velocity;
+    tension_.assign(params_.segments, 0.0);
+    return true;
+  }
+  double Tension(int segment) const { return tension_[segment]; }
+
+ private:
+  Parameters params_;
+  double node_mass_;
+  double rest_length_;
+  double segment_stiffness_;
+  double segment_damping_;
+  double max_step_;
+
+  std::vector<Eigen::Vector3d> position_;
+  std::vector<Eigen::Vector3d> velocity_;
+  std::vector<Eigen::Vector3d> force_;
+  std::vector<Eigen::Vector3d> direction_;
+  std::vector<double> tension_;
+};
+
+}
+
+#endif // MMUAV_PLUGINS_CABLE_MODEL_H
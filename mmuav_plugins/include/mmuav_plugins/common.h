@@ -29,7 +29,6 @@ namespace gazebo {
 
 // Default values
 static const std::string kDefaultNamespace = "";
-static constexpr double kDefaultRotorVelocitySlowdownSim = 10.0;
 
 /**
  * \brief Obtains a parameter from sdf.
@@ -98,6 +97,11 @@ discretized system (ZoH):
       return outputState;
 
     }
+
+    // Filter state, for resets and snapshots.
+    T getState() const { return previousState_; }
+    void setState(T state) { previousState_ = state; }
+
     ~FirstOrderFilter() {}
 
   protected:
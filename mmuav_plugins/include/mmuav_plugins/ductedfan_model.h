@@ -0,0 +1,116 @@
+/*
+ * Ducted fan rotor equations without Gazebo, shared by the motor model
+ * plugin and the offline rotor tool (rotor_model_tool). Forces and moments
+ * are in the rotor frame: z along the rotor axis, the control flap acts
+ * along x for motors 0 and 2 and along y for motors 1 and 3.
+ */
+
+#ifndef MMUAV_PLUGINS_DUCTEDFAN_MODEL_H
+#define MMUAV_PLUGINS_DUCTEDFAN_MODEL_H
+
+#include <cmath>
+
+namespace gazebo {
+// Default values
+static constexpr double kDefaultMotorConstant = 8.54858e-06;
+static constexpr double kDefaultMomentConstant = 0.016;
+static constexpr double kDefaultTimeConstantUp = 1.0 / 80.0;
+static constexpr double kDefaultTimeConstantDown = 1.0 / 40.0;
+static constexpr double kDefaulMaxRotVelocity = 838.0;
+static constexpr double kDefaultRotorDragCoefficient = 1.0e-4;
+static constexpr double kDefaultRollingMomentCoefficient = 1.0e-6;
+static constexpr double kDefaultRotorVelocitySlowdownSim = 10.0;
+// Largest control flap angle the equations are valid for, larger values
+// (e.g. before the flap controllers are up) are treated as 0
+static constexpr double kMaxControlFlapAngle = 0.3;
+
+// Rotor and ducted fan coefficients. Rotors with the same coefficients share
+// one block, parsed when the first of them is loaded.
+struct DuctedFanParameters {
+  double max_rot_velocity = kDefaulMaxRotVelocity;
+  double moment_constant = kDefaultMomentConstant;
+  double motor_constant = kDefaultMotorConstant;
+  double rolling_moment_coefficient = kDefaultRollingMomentCoefficient;
+  double rotor_drag_coefficient = kDefaultRotorDragCoefficient;
+  double rotor_velocity_slowdown_sim = kDefaultRotorVelocitySlowdownSim;
+  double time_constant_down = kDefaultTimeConstantDown;
+  double time_constant_up = kDefaultTimeConstantUp;
+
+  double fluid_density = 0.0;
+  double area_control_flap = 0.0;
+  double area_antitorque_flap = 0.0;
+  double distance_control_flap = 0.0;
+  double distance_antitorque_flap = 0.0;
+  double thrust_coefficient = 0.0;
+  double torque_coefficient = 0.0;
+  double slip_velocity_coefficient = 0.0;
+  double lift_coefficient_control_flap = 0.0;
+  double drag_coefficient_control_flap = 0.0;
+  double lift_coefficient_antitorque_flap = 0.0;
+  double drag_coefficient_antitorque_flap = 0.0;
+  double lift_coefficient_control_flap_at0 = 0.0;
+  double drag_coefficient_control_flap_at0 = 0.0;
+  double lift_coefficient_antitorque_flap_at0 = 0.0;
+  double drag_coefficient_antitorque_flap_at0 = 0.0;
+};
+
+struct DuctedFanWrench {
+  // Thrust, flap and drag torque, rotor frame
+  double force[3];
+  double moment[3];
+  // From the airspeed perpendicular to the rotor axis, in the frame the
+  // airspeed is given in
+  double air_drag[3];
+  double rolling_moment[3];
+};
+
+// Wrench of one rotor turning at rotor_velocity [rad/s] (the real velocity,
+// not the slowed down joint velocity) with the control flap at flap_angle
+// and the antitorque flap at antitorque_flap_angle [rad]. flap_x/flap_y
+// select the axis of the control flap (1 or 0), turning_direction is 1 for
+// CCW and -1 for CW. thrust_scale corrects the thrust, not the drag torque,
+// for surfaces close to the rotor. Branch free apart from the flap limit,
+// so loops over samples vectorize.
+inline DuctedFanWrench EvaluateDuctedFan(const DuctedFanParameters& p, double rotor_velocity,
+                                         double flap_angle, double antitorque_flap_angle,
+                                         double flap_x, double flap_y, int turning_direction,
+                                         const double airspeed_perpendicular[3],
+                                         double thrust_scale = 1.0) {
+  if (flap_angle > kMaxControlFlapAngle || flap_angle < -kMaxControlFlapAngle)
+    flap_angle = 0.0;
+
+  double velocity_squared = rotor_velocity * rotor_velocity;
+  double slip_velocity_squared = velocity_squared * p.slip_velocity_coefficient;
+  double flap_lift = p.fluid_density * p.area_control_flap * slip_velocity_squared *
+                     p.lift_coefficient_control_flap * flap_angle;
+  double force_antitorque_flap = p.fluid_density * p.area_antitorque_flap * slip_velocity_squared *
+      (p.drag_coefficient_antitorque_flap * antitorque_flap_angle * antitorque_flap_angle +
+       p.drag_coefficient_antitorque_flap_at0);
+  double force_thrust = velocity_squared * p.thrust_coefficient;
+  double force_control_flap = p.fluid_density * p.area_control_flap * slip_velocity_squared *
+      (p.drag_coefficient_control_flap * flap_angle * flap_angle + p.drag_coefficient_control_flap_at0);
+
+  DuctedFanWrench wrench;
+  wrench.force[0] = flap_lift * flap_x;
+  wrench.force[1] = flap_lift * flap_y;
+  wrench.force[2] = thrust_scale * force_thrust - force_antitorque_flap - force_control_flap;
+  wrench.moment[0] = wrench.force[0] * p.distance_control_flap;
+  wrench.moment[1] = wrench.force[1] * p.distance_control_flap;
+  // The antitorque part of the formulas is not used
+  wrench.moment[2] = -turning_direction * p.torque_coefficient * force_thrust;
+
+  // Forces from Philppe Martin's and Erwan Salaün's
+  // 2010 IEEE Conference on Robotics and Automation paper
+  // The True Role of Accelerometer Feedback in Quadrotor Control
+  // - \omega * \lambda_1 * V_A^{\perp} and - \omega * \mu_1 * V_A^{\perp}
+  double speed = std::abs(rotor_velocity);
+  for (int i = 0; i < 3; i++) {
+    wrench.air_drag[i] = -speed * p.rotor_drag_coefficient * airspeed_perpendicular[i];
+    wrench.rolling_moment[i] = -speed * p.rolling_moment_coefficient * airspeed_perpendicular[i];
+  }
+  return wrench;
+}
+
+}
+
+#endif // MMUAV_PLUGINS_DUCTEDFAN_MODEL_H
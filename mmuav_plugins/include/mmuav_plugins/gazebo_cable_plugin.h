@@ -0,0 +1,98 @@
+/*
+ * Cable between two links simulated inside the plugin as a lumped mass
+ * chain (see cable_model.h). Only the cable force at the attachment points
+ * is applied to the links, so a slung load needs no chain of tiny rope
+ * links and joints in the physics engine.
+ *
+ * The child link may belong to another model, give it with its scoped name
+ * (e.g. "load::load"), it is looked up until it has been spawned.
+ *
+ * The node positions and velocities are part of the plugin snapshots, so a
+ * restored cable matches the restored attachment points.
+ */
+
+#ifndef MMUAV_PLUGINS_GAZEBO_CABLE_PLUGIN_H
+#define MMUAV_PLUGINS_GAZEBO_CABLE_PLUGIN_H
+
+#include <string>
+
+#include <boost/bind.hpp>
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <geometry_msgs/WrenchStamped.h>
+#include <ros/ros.h>
+
+#include "common.h"
+#include "cable_model.h"
+#include "plugin_snapshot.h"
+
+namespace gazebo {
+// Default values
+static const std::string kDefaultParentWrenchPubTopic = "ft_sensor_topic_base";
+static const std::string kDefaultChildWrenchPubTopic = "ft_sensor_topic_load";
+static constexpr int kDefaultMaxSubsteps = 200;
+static constexpr double kDefaultWrenchPublishRate = 100.0;
+
+class GazeboCablePlugin : public ModelPlugin, public SnapshotClient {
+ public:
+  GazeboCablePlugin()
+      : ModelPlugin(),
+        parent_wrench_pub_topic_(kDefaultParentWrenchPubTopic),
+        child_wrench_pub_topic_(kDefaultChildWrenchPubTopic),
+        max_substeps_(kDefaultMaxSubsteps),
+        wrench_publish_rate_(kDefaultWrenchPublishRate),
+        prev_sim_time_(0.0),
+        last_publish_time_(0.0),
+        node_handle_(nullptr) {}
+
+  virtual ~GazeboCablePlugin();
+
+  virtual std::string SnapshotId() const;
+  virtual void SaveState(StateWriter& writer) const;
+  virtual bool RestoreState(StateReader& reader);
+
+ protected:
+  virtual void Load(physics::ModelPtr _model, sdf::ElementPtr _sdf);
+  virtual void Reset();
+  virtual void OnUpdate(const common::UpdateInfo& _info);
+
+ private:
+  bool FindChildLink();
+  void PublishWrench(const ros::Publisher& pub, const physics::LinkPtr& link,
+                     const ignition::math::Vector3d& attachment,
+                     const ignition::math::Vector3d& force,
+                     const common::Time& stamp);
+
+  std::string namespace_;
+  std::string parent_link_name_;
+  std::string child_link_name_;
+  std::string parent_wrench_pub_topic_;
+  std::string child_wrench_pub_topic_;
+
+  // Attachment points in the link frames
+  ignition::math::Vector3d parent_offset_;
+  ignition::math::Vector3d child_offset_;
+
+  int max_substeps_;
+  double wrench_publish_rate_;
+  double prev_sim_time_;
+  double last_publish_time_;
+
+  CableModel cable_;
+
+  physics::ModelPtr model_;
+  physics::LinkPtr parent_link_;
+  physics::LinkPtr child_link_;
+
+  ros::NodeHandle* node_handle_;
+  ros::Publisher parent_wrench_pub_;
+  ros::Publisher child_wrench_pub_;
+
+  /// \brief Pointer to the update event connection.
+  event::ConnectionPtr updateConnection_;
+};
+}
+
+#endif // MMUAV_PLUGINS_GAZEBO_CABLE_PLUGIN_H
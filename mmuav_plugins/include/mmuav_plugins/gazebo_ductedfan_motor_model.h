@@ -7,6 +7,7 @@
 #include <stdio.h>
 
 #include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
 #include <Eigen/Eigen>
 #include <gazebo/common/common.hh>
 #include <gazebo/common/Plugin.hh>
@@ -22,7 +23,12 @@
 #include <control_msgs/JointControllerState.h>
 
 #include "common.h"
+#include "ductedfan_model.h"
 #include "motor_model.hpp"
+#include "parallel_update.h"
+#include "plugin_snapshot.h"
+#include "proximity_effect.h"
+#include "sdf_param_cache.h"
 
 namespace turning_direction {
 const static int CCW = 1;
@@ -37,15 +43,15 @@ static const std::string kDefaultAngleflapSubTopic = "mmuav/angle";
 
 // Set the max_force_ to the max double value. The limitations get handled by the FirstOrderFilter.
 static constexpr double kDefaultMaxForce = std::numeric_limits<double>::max();
-static constexpr double kDefaultMotorConstant = 8.54858e-06;
-static constexpr double kDefaultMomentConstant = 0.016;
-static constexpr double kDefaultTimeConstantUp = 1.0 / 80.0;
-static constexpr double kDefaultTimeConstantDown = 1.0 / 40.0;
-static constexpr double kDefaulMaxRotVelocity = 838.0;
-static constexpr double kDefaultRotorDragCoefficient = 1.0e-4;
-static constexpr double kDefaultRollingMomentCoefficient = 1.0e-6;
-
-class GazeboMotorModel : public MotorModel, public ModelPlugin {
+// A parameter set summary is printed every this many loaded rotors
+static constexpr unsigned long kParameterCacheReportInterval = 16;
+static constexpr double kDefaultRotorRadius = 0.1;
+// Hits on the own vehicle skipped per proximity ray, and the step past each
+static constexpr int kMaxProximityRayHits = 4;
+static constexpr double kProximityRaySkip = 0.01;  // [m]
+
+class GazeboMotorModel : public MotorModel, public ModelPlugin, public ParallelUpdateClient,
+                         public SnapshotClient {
  public:
   GazeboMotorModel()
       : ModelPlugin(),
@@ -57,26 +63,39 @@ class GazeboMotorModel : public MotorModel, public ModelPlugin {
         motor_number_(0),
         turning_direction_(turning_direction::CW),
         max_force_(kDefaultMaxForce),
-        max_rot_velocity_(kDefaulMaxRotVelocity),
-        moment_constant_(kDefaultMomentConstant),
-        motor_constant_(kDefaultMotorConstant),
         ref_motor_rot_vel_(0.0),
-        rolling_moment_coefficient_(kDefaultRollingMomentCoefficient),
-        rotor_drag_coefficient_(kDefaultRotorDragCoefficient),
-        rotor_velocity_slowdown_sim_(kDefaultRotorVelocitySlowdownSim),
-        time_constant_down_(kDefaultTimeConstantDown),
-        time_constant_up_(kDefaultTimeConstantUp),
+        angle_control_flap_(0.0),
+        angle_antitorque_flap_(0.0),
+        angle_control_flap_ref_(0.0),
         node_handle_(nullptr),
-        wind_speed_W_(0, 0, 0) {}
+        wind_speed_W_(0, 0, 0),
+        step_ref_motor_rot_vel_(0.0),
+        step_wind_speed_W_(0, 0, 0),
+        step_angle_control_flap_(0.0),
+        step_angle_control_flap_ref_(0.0),
+        joint_velocity_command_(0.0),
+        rotor_radius_(kDefaultRotorRadius),
+        proximity_update_period_(1.0 / kDefaultProximityUpdateRate),
+        proximity_update_time_(-1.0),
+        thrust_scale_(1.0) {}
 
   virtual ~GazeboMotorModel();
 
   virtual void InitializeParams();
   virtual void Publish();
 
+  virtual void ReadState(const common::UpdateInfo& _info);
+  virtual void Compute();
+  virtual void ApplyWrench();
+
+  virtual std::string SnapshotId() const;
+  virtual void SaveState(StateWriter& writer) const;
+  virtual bool RestoreState(StateReader& reader);
+
  protected:
   virtual void UpdateForcesAndMoments();
   virtual void Load(physics::ModelPtr _model, sdf::ElementPtr _sdf);
+  virtual void Reset();
   virtual void OnUpdate(const common::UpdateInfo & /*_info*/);
 
  private:
@@ -97,32 +116,12 @@ class GazeboMotorModel : public MotorModel, public ModelPlugin {
   int flag_y;
 
   double max_force_;
-  double max_rot_velocity_;
-  double moment_constant_;
-  double motor_constant_;
   double ref_motor_rot_vel_;
-  double rolling_moment_coefficient_;
-  double rotor_drag_coefficient_;
-  double rotor_velocity_slowdown_sim_;
-  double time_constant_down_;
-  double time_constant_up_;
-
-  double fluid_density_;
-  double area_control_flap_;
-  double area_antitorque_flap_;
-  double distance_control_flap_;
-  double distance_antitorque_flap_;
-  double thrust_coefficient_;
-  double torque_coefficient_;
-  double slip_velocity_coefficient_;
-  double lift_coefficient_control_flap_;
-  double drag_coefficient_control_flap_;
-  double lift_coefficient_antitorque_flap_;
-  double drag_coefficient_antitorque_flap_;
-  double lift_coefficient_control_flap_at0_;
-  double drag_coefficient_control_flap_at0_;
-  double lift_coefficient_antitorque_flap_at0_;
-  double drag_coefficient_antitorque_flap_at0_;
+
+  // Shared with every rotor of the same configuration, read only
+  std::shared_ptr<const DuctedFanParameters> params_;
+  static void ParseParameters(sdf::ElementPtr sdf, DuctedFanParameters* params);
+
   double angle_control_flap_;
   double angle_antitorque_flap_;
   double angle_control_flap_ref_;
@@ -157,6 +156,43 @@ class GazeboMotorModel : public MotorModel, public ModelPlugin {
 
   std::unique_ptr<FirstOrderFilter<double>> rotor_velocity_filter_;
   ignition::math::Vector3<double> wind_speed_W_;
+
+  // Written by the subscriber callbacks: ref_motor_rot_vel_, wind_speed_W_,
+  // angle_control_flap_ and angle_control_flap_ref_. ReadState copies them,
+  // Compute and Publish use the copies only.
+  mutable boost::mutex input_mutex_;
+  double step_ref_motor_rot_vel_;
+  ignition::math::Vector3<double> step_wind_speed_W_;
+  double step_angle_control_flap_;
+  double step_angle_control_flap_ref_;
+
+  // State read on the update thread
+  ignition::math::Vector3<double> joint_axis_W_;
+  ignition::math::Vector3<double> body_velocity_W_;
+  ignition::math::Quaternion<double> rotor_orientation_W_;
+  // Fixed, the rotor frame in the parent link frame
+  ignition::math::Quaternion<double> rotor_orientation_P_;
+  physics::LinkPtr parent_link_;
+  // Wrench accumulated in the world frame, applied once per step: the force
+  // to the rotor link, the torque to its parent
+  ignition::math::Vector3<double> force_W_;
+  ignition::math::Vector3<double> torque_W_;
+  double joint_velocity_command_;
+
+  // Ground and wall effect, enabled by proximityEffect. The surface
+  // distances are queried with a ray at proximityUpdateRate and the thrust
+  // correction is kept in between.
+  physics::RayShapePtr proximity_ray_;
+  ProximityTable ground_effect_table_;
+  ProximityTable wall_effect_table_;
+  double rotor_radius_;
+  double proximity_update_period_;
+  double proximity_update_time_;
+  double thrust_scale_;
+  void LoadProximityEffect(sdf::ElementPtr sdf);
+  void UpdateProximityEffect();
+  double SurfaceDistance(const ignition::math::Vector3<double>& origin,
+                         const ignition::math::Vector3<double>& direction, double range);
 };
 }
 
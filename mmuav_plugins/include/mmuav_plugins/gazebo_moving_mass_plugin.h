@@ -0,0 +1,130 @@
+/*
+ * Movable masses of the MMC vehicles modelled inside the plugin instead of
+ * prismatic joints under ros_control. Every mass is a second order servo
+ * tracking its command from movable_mass_all/command. The masses are
+ * fixed to base_link at the middle of their paths (so the physics engine
+ * lumps their rigid mass and inertia into it), the plugin applies the
+ * wrench of their displacement and relative motion to base_link.
+ */
+
+#ifndef MMUAV_PLUGINS_GAZEBO_MOVING_MASS_PLUGIN_H
+#define MMUAV_PLUGINS_GAZEBO_MOVING_MASS_PLUGIN_H
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <ros/ros.h>
+#include <std_msgs/Float64MultiArray.h>
+
+#include "common.h"
+#include "parallel_update.h"
+#include "plugin_snapshot.h"
+
+namespace gazebo {
+// Default values
+static const std::string kDefaultMassCommandSubTopic = "movable_mass_all/command";
+static const std::string kDefaultMassStatePubTopic = "movable_mass_all/state";
+static constexpr double kDefaultMovableMass = 0.208;
+static constexpr double kDefaultMassPathLimit = 0.085;
+static constexpr double kDefaultMassNaturalFrequency = 25.0;
+static constexpr double kDefaultMassDampingRatio = 0.9;
+static constexpr double kDefaultMassMaxVelocity = 0.5;
+static constexpr double kDefaultMassStatePublishRate = 100.0;
+
+class GazeboMovingMassPlugin : public ModelPlugin, public ParallelUpdateClient,
+                               public SnapshotClient {
+ public:
+  GazeboMovingMassPlugin()
+      : ModelPlugin(),
+        command_sub_topic_(kDefaultMassCommandSubTopic),
+        state_pub_topic_(kDefaultMassStatePubTopic),
+        mass_(kDefaultMovableMass),
+        path_limit_(kDefaultMassPathLimit),
+        natural_frequency_(kDefaultMassNaturalFrequency),
+        damping_ratio_(kDefaultMassDampingRatio),
+        max_velocity_(kDefaultMassMaxVelocity),
+        state_publish_rate_(kDefaultMassStatePublishRate),
+        prev_sim_time_(0.0),
+        last_publish_time_(0.0),
+        dt_(0.0),
+        node_handle_(nullptr) {}
+
+  virtual ~GazeboMovingMassPlugin();
+
+  virtual std::string SnapshotId() const;
+  virtual void SaveState(StateWriter& writer) const;
+  virtual bool RestoreState(StateReader& reader);
+
+ protected:
+  virtual void Load(physics::ModelPtr _model, sdf::ElementPtr _sdf);
+  virtual void Reset();
+  virtual void OnUpdate(const common::UpdateInfo& _info);
+
+  virtual void ReadState(const common::UpdateInfo& _info);
+  virtual void Compute();
+  virtual void ApplyWrench();
+
+ private:
+  // One mass moving along axis through origin, both in the link frame
+  struct MovableMass {
+    ignition::math::Vector3d origin;
+    ignition::math::Vector3d axis;
+    double command;
+    double position;
+    double velocity;
+    double acceleration;
+  };
+
+  void CommandCallback(const std_msgs::Float64MultiArrayConstPtr& msg);
+  void UpdateServos(double dt);
+  void ComputeWrench();
+  void PublishState();
+
+  std::string namespace_;
+  std::string link_name_;
+  std::string command_sub_topic_;
+  std::string state_pub_topic_;
+
+  double mass_;
+  double path_limit_;
+  double natural_frequency_;
+  double damping_ratio_;
+  double max_velocity_;
+  double state_publish_rate_;
+  double prev_sim_time_;
+  double last_publish_time_;
+
+  // State read on the update thread and the wrench computed from it
+  double dt_;
+  ignition::math::Pose3d pose_;
+  ignition::math::Vector3d cog_;
+  ignition::math::Vector3d omega_;
+  ignition::math::Vector3d gravity_;
+  ignition::math::Vector3d force_;
+  ignition::math::Vector3d torque_;
+
+  std::vector<MovableMass> masses_;
+  // Commands arrive on the ROS callback thread
+  boost::mutex command_mutex_;
+  std::vector<double> commands_;
+
+  physics::ModelPtr model_;
+  physics::LinkPtr link_;
+
+  ros::NodeHandle* node_handle_;
+  ros::Subscriber command_sub_;
+  ros::Publisher state_pub_;
+  std_msgs::Float64MultiArray state_msg_;
+
+  /// \brief Pointer to the update event connection.
+  event::ConnectionPtr updateConnection_;
+};
+}
+
+#endif // MMUAV_PLUGINS_GAZEBO_MOVING_MASS_PLUGIN_H
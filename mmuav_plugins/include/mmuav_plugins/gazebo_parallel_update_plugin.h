@@ -0,0 +1,66 @@
+/*
+ * World plugin driving the registered vehicle plugins (see
+ * parallel_update.h) on a fixed worker pool. Every step the state of all
+ * clients is read serially, their wrenches are computed in parallel and
+ * then applied serially, so Gazebo is only ever called from the update
+ * thread.
+ */
+
+#ifndef MMUAV_PLUGINS_GAZEBO_PARALLEL_UPDATE_PLUGIN_H
+#define MMUAV_PLUGINS_GAZEBO_PARALLEL_UPDATE_PLUGIN_H
+
+#include <memory>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include "common.h"
+#include "parallel_update.h"
+
+namespace gazebo {
+// Default values, 0 threads - one per core
+static constexpr int kDefaultParallelUpdateThreads = 0;
+static constexpr double kDefaultParallelUpdateStatisticsPeriod = 10.0;
+
+class GazeboParallelUpdatePlugin : public WorldPlugin {
+ public:
+  GazeboParallelUpdatePlugin()
+      : WorldPlugin(),
+        client_version_(0),
+        statistics_period_(kDefaultParallelUpdateStatisticsPeriod),
+        steps_(0),
+        read_time_(0.0),
+        compute_time_(0.0),
+        apply_time_(0.0) {}
+
+  virtual ~GazeboParallelUpdatePlugin();
+
+ protected:
+  virtual void Load(physics::WorldPtr _world, sdf::ElementPtr _sdf);
+  virtual void OnUpdate(const common::UpdateInfo& _info);
+
+ private:
+  std::unique_ptr<WorkerPool> pool_;
+  std::vector<ParallelUpdateClient*> clients_;
+  unsigned long client_version_;
+
+  // Average time per step of each phase, printed every statistics_period_
+  // seconds of wall time, 0 - never
+  double statistics_period_;
+  common::Time statistics_start_;
+  unsigned long steps_;
+  double read_time_;
+  double compute_time_;
+  double apply_time_;
+  void ReportStatistics();
+
+  /// \brief Pointer to the update event connection.
+  event::ConnectionPtr updateConnection_;
+};
+}
+
+#endif // MMUAV_PLUGINS_GAZEBO_PARALLEL_UPDATE_PLUGIN_H
@@ -0,0 +1,82 @@
+/*
+ * World plugin serving snapshots of the plugin state (see
+ * plugin_snapshot.h) over the mmuav_msgs/PluginState service. The plugin
+ * adds the poses and twists of all links to the snapshot, so restoring a
+ * checkpoint, e.g. a hovering vehicle, replaces a respawn or a relaunch of
+ * Gazebo between trials. The simulation time is not restored.
+ *
+ * Requests run on the simulation thread at the end of a world update, when
+ * no plugin is between reading its state and applying its wrench.
+ */
+
+#ifndef MMUAV_PLUGINS_GAZEBO_SNAPSHOT_PLUGIN_H
+#define MMUAV_PLUGINS_GAZEBO_SNAPSHOT_PLUGIN_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <mmuav_msgs/PluginState.h>
+#include <ros/ros.h>
+
+#include "common.h"
+#include "plugin_snapshot.h"
+
+namespace gazebo {
+// Default values
+static const std::string kDefaultPluginStateService = "/gazebo/plugin_state";
+
+class GazeboSnapshotPlugin : public WorldPlugin, public SnapshotClient {
+ public:
+  GazeboSnapshotPlugin()
+      : WorldPlugin(),
+        service_name_(kDefaultPluginStateService),
+        pending_(nullptr),
+        node_handle_(nullptr) {}
+
+  virtual ~GazeboSnapshotPlugin();
+
+  virtual std::string SnapshotId() const;
+  virtual void SaveState(StateWriter& writer) const;
+  virtual bool RestoreState(StateReader& reader);
+
+ protected:
+  virtual void Load(physics::WorldPtr _world, sdf::ElementPtr _sdf);
+
+ private:
+  bool PluginStateCallback(mmuav_msgs::PluginState::Request& request,
+                           mmuav_msgs::PluginState::Response& response);
+  void OnWorldUpdateEnd();
+  void RunRequest(const mmuav_msgs::PluginState::Request& request,
+                  mmuav_msgs::PluginState::Response& response);
+
+  // Request handed from the service callback to the simulation thread
+  struct PendingRequest {
+    const mmuav_msgs::PluginState::Request* request;
+    mmuav_msgs::PluginState::Response* response;
+    bool done;
+  };
+
+  std::string service_name_;
+  // Checkpoints saved with a name
+  std::map<std::string, std::vector<uint8_t>> checkpoints_;
+
+  physics::WorldPtr world_;
+  event::ConnectionPtr update_connection_;
+
+  std::mutex request_mutex_;
+  std::condition_variable request_cond_;
+  PendingRequest* pending_;
+
+  ros::NodeHandle* node_handle_;
+  ros::ServiceServer plugin_state_service_;
+};
+}
+
+#endif // MMUAV_PLUGINS_GAZEBO_SNAPSHOT_PLUGIN_H
@@ -0,0 +1,70 @@
+/*
+ * Hardware in the loop for the movable masses. Sends mass commands straight
+ * to the stepper board over the SerialTransport of mmuav_arducopter_bridge
+ * and mirrors the measured mass positions into the prismatic joints of the
+ * model, with no ROS hop between the controller topic and the UART.
+ *
+ * SDF parameters: port, baudrate, protocol, linkBudget, maxCommandRate,
+ * stepsPerMeter, massLimit [m], commandSubTopic, robotNamespace and
+ * jointPrefix (joints <jointPrefix>0..3). Run it instead of the moving mass
+ * controllers (mass_model:=hil), the joints are set kinematically.
+ */
+
+#ifndef MMUAV_PLUGINS_GAZEBO_STEPPER_HIL_PLUGIN_H
+#define MMUAV_PLUGINS_GAZEBO_STEPPER_HIL_PLUGIN_H
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <ros/ros.h>
+#include <std_msgs/Float64MultiArray.h>
+
+#include <SerialTransport.h>
+
+#include "common.h"
+
+namespace gazebo {
+
+class GazeboStepperHilPlugin : public ModelPlugin {
+ public:
+  GazeboStepperHilPlugin();
+  virtual ~GazeboStepperHilPlugin();
+
+ protected:
+  virtual void Load(physics::ModelPtr _model, sdf::ElementPtr _sdf);
+  virtual void OnUpdate(const common::UpdateInfo & /*_info*/);
+
+ private:
+  void CommandCallback(const std_msgs::Float64MultiArray &msg);
+  void HandleFrame(const StepperLink::Frame &frame, double received_time);
+
+  std::string namespace_;
+  std::string command_sub_topic_;
+  // Stepper positions are sent in steps, mass positions in meters
+  double steps_per_meter_;
+  double mass_limit_;
+
+  SerialTransport transport_;
+  SerialTransport::Settings settings_;
+
+  physics::ModelPtr model_;
+  std::vector<physics::JointPtr> joints_;
+
+  // Latest measured positions [m], written by the transport I/O thread
+  boost::mutex feedback_mutex_;
+  bool feedback_received_;
+  double measured_position_[StepperProtocol::VALUES];
+
+  ros::NodeHandle* node_handle_;
+  ros::Subscriber command_sub_;
+  event::ConnectionPtr updateConnection_;
+};
+
+}
+
+#endif // MMUAV_PLUGINS_GAZEBO_STEPPER_HIL_PLUGIN_H
@@ -0,0 +1,102 @@
+/*
+ * Parallel updates of vehicle plugins. Plugins implementing
+ * ParallelUpdateClient register with the ParallelUpdateRegistry. When the
+ * parallel update world plugin is loaded it drives all of them every step
+ * in three phases separated by barriers: ReadState on the update thread,
+ * Compute on a worker pool and ApplyWrench on the update thread again.
+ * Without the world plugin every client runs the three phases from its own
+ * update event.
+ *
+ * The registry lives in its own library so all plugin libraries share it.
+ */
+
+#ifndef MMUAV_PLUGINS_PARALLEL_UPDATE_H
+#define MMUAV_PLUGINS_PARALLEL_UPDATE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gazebo/common/common.hh>
+
+namespace gazebo {
+
+class ParallelUpdateClient {
+ public:
+  virtual ~ParallelUpdateClient() {}
+
+  // Update thread: copies the simulation state Compute needs
+  virtual void ReadState(const common::UpdateInfo& info) = 0;
+  // Worker thread: computes the wrenches. Must not call into Gazebo or
+  // share data with other clients.
+  virtual void Compute() = 0;
+  // Update thread: applies the wrenches and publishes
+  virtual void ApplyWrench() = 0;
+
+  // All three phases, for clients running on their own
+  void UpdateSerial(const common::UpdateInfo& info) {
+    ReadState(info);
+    Compute();
+    ApplyWrench();
+  }
+};
+
+class ParallelUpdateRegistry {
+ public:
+  static ParallelUpdateRegistry& Instance();
+
+  void Register(ParallelUpdateClient* client);
+  void Unregister(ParallelUpdateClient* client);
+
+  // Set while a world plugin drives the clients, they skip their own
+  // update events then
+  void SetDriven(bool driven) { driven_ = driven; }
+  bool Driven() const { return driven_; }
+
+  // Registered clients in registration order. The version changes with
+  // every (un)registration, so the driver only copies the list when needed.
+  unsigned long Version() const { return version_; }
+  void GetClients(std::vector<ParallelUpdateClient*>& clients) const;
+
+ private:
+  ParallelUpdateRegistry() : driven_(false), version_(0) {}
+
+  mutable std::mutex mutex_;
+  std::vector<ParallelUpdateClient*> clients_;
+  std::atomic<bool> driven_;
+  std::atomic<unsigned long> version_;
+};
+
+// Fixed pool of threads running indexed tasks. Run returns when all tasks
+// are done, the calling thread takes tasks as well.
+class WorkerPool {
+ public:
+  // threads includes the calling thread
+  explicit WorkerPool(unsigned int threads);
+  ~WorkerPool();
+
+  unsigned int Threads() const { return unsigned(workers_.size()) + 1; }
+  void Run(size_t count, const std::function<void(size_t)>& task);
+
+ private:
+  void Work();
+  void RunTasks();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const std::function<void(size_t)>* task_;
+  size_t count_;
+  std::atomic<size_t> next_;
+  unsigned int busy_;
+  unsigned long generation_;
+  bool stop_;
+};
+
+}
+
+#endif // MMUAV_PLUGINS_PARALLEL_UPDATE_H
@@ -0,0 +1,116 @@
+/*
+ * Snapshot and restore of the internal state of the simulation plugins.
+ * Plugins implementing SnapshotClient register with the SnapshotRegistry,
+ * which saves all of them into one binary blob and restores them from it.
+ * Together with the model state this resets a scenario without respawning
+ * models or relaunching Gazebo.
+ *
+ * Blob layout, native byte order: magic, version, client count, then per
+ * client its id, payload size and payload. The blob is only meant to be
+ * restored by the same build on the same machine type.
+ *
+ * The registry lives in its own library so all plugin libraries share it.
+ */
+
+#ifndef MMUAV_PLUGINS_PLUGIN_SNAPSHOT_H
+#define MMUAV_PLUGINS_PLUGIN_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gazebo {
+
+class StateWriter {
+ public:
+  explicit StateWriter(std::vector<uint8_t>* data) : data_(data) {}
+
+  void Write(double value) { Append(&value, sizeof(value)); }
+  void Write(uint32_t value) { Append(&value, sizeof(value)); }
+  void Write(const std::string& value) {
+    Write(uint32_t(value.size()));
+    Append(value.data(), value.size());
+  }
+
+  size_t Size() const { return data_->size(); }
+
+ private:
+  void Append(const void* value, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    data_->insert(data_->end(), bytes, bytes + size);
+  }
+
+  std::vector<uint8_t>* data_;
+};
+
+// Reads from [begin, end) of a blob, every Read fails once past the end
+class StateReader {
+ public:
+  StateReader(const uint8_t* begin, const uint8_t* end) : position_(begin), end_(end) {}
+
+  bool Read(double* value) { return Take(value, sizeof(*value)); }
+  bool Read(uint32_t* value) { return Take(value, sizeof(*value)); }
+  bool Read(std::string* value) {
+    uint32_t size;
+    if (!Read(&size) || size_t(end_ - position_) < size) return false;
+    value->assign(reinterpret_cast<const char*>(position_), size);
+    position_ += size;
+    return true;
+  }
+
+  size_t Remaining() const { return size_t(end_ - position_); }
+
+ private:
+  bool Take(void* value, size_t size) {
+    if (size_t(end_ - position_) < size) return false;
+    std::memcpy(value, position_, size);
+    position_ += size;
+    return true;
+  }
+
+  const uint8_t* position_;
+  const uint8_t* end_;
+};
+
+class SnapshotClient {
+ public:
+  virtual ~SnapshotClient() {}
+
+  // Unique among the clients and the same in every run with the same
+  // models, e.g. model name and plugin name
+  virtual std::string SnapshotId() const = 0;
+  virtual void SaveState(StateWriter& writer) const = 0;
+  // False if the payload does not fit. The state may be partly restored
+  // then, the registry rolls it back with a payload of SaveState.
+  virtual bool RestoreState(StateReader& reader) = 0;
+};
+
+class SnapshotRegistry {
+ public:
+  static SnapshotRegistry& Instance();
+
+  void Register(SnapshotClient* client);
+  void Unregister(SnapshotClient* client);
+
+  // Callers make sure the clients are not updated meanwhile, e.g. by
+  // holding the physics update mutex
+  void Save(std::vector<uint8_t>* blob) const;
+  // Every registered client has to be in the blob, clients in the blob that
+  // are not registered are ignored. Returns false with the reason in error,
+  // all clients keep their state then.
+  bool Restore(const std::vector<uint8_t>& blob, std::string* error);
+
+  size_t Clients() const;
+
+ private:
+  SnapshotRegistry() {}
+
+  mutable std::mutex mutex_;
+  std::vector<SnapshotClient*> clients_;
+};
+
+}
+
+#endif // MMUAV_PLUGINS_PLUGIN_SNAPSHOT_H
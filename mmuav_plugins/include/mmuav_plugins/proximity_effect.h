@@ -0,0 +1,95 @@
+/*
+ * Thrust correction of a rotor close to the ground or to a wall, as a
+ * function of the distance from the rotor center to the surface in rotor
+ * radii. The curves are sampled into tables when the plugin loads, the
+ * update only interpolates.
+ */
+
+#ifndef MMUAV_PLUGINS_PROXIMITY_EFFECT_H
+#define MMUAV_PLUGINS_PROXIMITY_EFFECT_H
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace gazebo {
+// Default values
+static constexpr double kDefaultProximityUpdateRate = 20.0;  // [Hz]
+static constexpr double kDefaultProximityRange = 4.0;        // [rotor radii]
+// The wall only blocks the inflow from one side, half the ground effect
+static constexpr double kDefaultWallEffectCoefficient = 0.5;
+// The image method diverges at a quarter radius, closer distances use the
+// factor at this one
+static constexpr double kMinProximityDistance = 0.5;  // [rotor radii]
+static constexpr int kProximityTableSize = 128;
+
+// Cheeseman and Bennett, thrust in ground effect over thrust out of it at
+// the same rotor velocity: 1 / (1 - (R / 4z)^2)
+inline double GroundEffectFactor(double distance) {
+  double ratio = 0.25 / std::max(distance, kMinProximityDistance);
+  return 1.0 / (1.0 - ratio * ratio);
+}
+
+// Same image model for a wall parallel to the rotor axis, scaled down by
+// coefficient
+inline double WallEffectFactor(double distance, double coefficient) {
+  double ratio = 0.25 / std::max(distance, kMinProximityDistance);
+  return 1.0 / (1.0 - coefficient * ratio * ratio);
+}
+
+// Correction factor sampled at equal distances over [0, range], 1 from the
+// range on.
+class ProximityTable {
+ public:
+  explicit ProximityTable(double range = kDefaultProximityRange)
+      : range_(range), values_(kProximityTableSize, 1.0) {}
+
+  double Range() const { return range_; }
+
+  template <class Factor>
+  void Sample(const Factor& factor) {
+    for (int i = 0; i < kProximityTableSize; i++)
+      values_[i] = factor(range_ * i / (kProximityTableSize - 1));
+    // Ends at 1 so the factor does not jump where the surface leaves the range
+    values_.back() = 1.0;
+  }
+
+  // Measured curve as "distance factor distance factor ...", distances
+  // increasing. Linear between the points and constant outside of them.
+  bool SetPoints(const std::string& points) {
+    std::istringstream stream(points);
+    std::vector<double> distances, factors;
+    double distance, factor;
+    while (stream >> distance >> factor) {
+      if (!distances.empty() && distance <= distances.back()) return false;
+      distances.push_back(distance);
+      factors.push_back(factor);
+    }
+    if (distances.empty() || !stream.eof()) return false;
+    Sample([&](double d) -> double {
+      if (d <= distances.front()) return factors.front();
+      if (d >= distances.back()) return factors.back();
+      size_t i = std::upper_bound(distances.begin(), distances.end(), d) - distances.begin();
+      double t = (d - distances[i - 1]) / (distances[i] - distances[i - 1]);
+      return factors[i - 1] + t * (factors[i] - factors[i - 1]);
+    });
+    return true;
+  }
+
+  double Lookup(double distance) const {
+    if (distance >= range_) return 1.0;
+    double position = std::max(distance, 0.0) / range_ * (kProximityTableSize - 1);
+    int i = std::min(int(position), kProximityTableSize - 2);
+    double t = position - i;
+    return values_[i] + t * (values_[i + 1] - values_[i]);
+  }
+
+ private:
+  double range_;
+  std::vector<double> values_;
+};
+
+}
+
+#endif // MMUAV_PLUGINS_PROXIMITY_EFFECT_H
@@ -0,0 +1,104 @@
+/*
+ * Cache of parameter blocks parsed from plugin SDF. Plugins with the same
+ * configuration, e.g. the rotors of many spawned vehicles of one type, parse
+ * it once and share one immutable block.
+ *
+ * The key is the content of the plugin element without the per instance
+ * elements (names, namespaces, topics), those are read by every plugin.
+ */
+
+#ifndef MMUAV_PLUGINS_SDF_PARAM_CACHE_H
+#define MMUAV_PLUGINS_SDF_PARAM_CACHE_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <sdf/sdf.hh>
+
+namespace gazebo {
+
+template <class Parameters>
+class SdfParamCache {
+ public:
+  typedef std::shared_ptr<const Parameters> ParametersPtr;
+  typedef std::function<void(sdf::ElementPtr, Parameters*)> Parser;
+
+  struct Statistics {
+    unsigned long lookups;
+    unsigned long hits;
+    size_t entries;
+    double key_time;    // building keys [s]
+    double parse_time;  // parsing new blocks [s]
+  };
+
+  explicit SdfParamCache(const std::set<std::string>& instance_elements)
+      : instance_elements_(instance_elements) {
+    statistics_ = Statistics();
+  }
+
+  // Returns the parameter block of sdf, parse fills it in on first use.
+  // parsed is set if this call parsed a new block.
+  ParametersPtr Get(sdf::ElementPtr sdf, const Parser& parse,
+                    bool* parsed = nullptr) {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = Key(sdf);
+    auto keyed = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.lookups++;
+    statistics_.key_time += Seconds(start, keyed);
+    if (parsed) *parsed = false;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      statistics_.hits++;
+      return it->second;
+    }
+
+    std::shared_ptr<Parameters> params(new Parameters);
+    parse(sdf, params.get());
+    entries_[key] = params;
+    statistics_.entries = entries_.size();
+    statistics_.parse_time += Seconds(keyed, std::chrono::steady_clock::now());
+    if (parsed) *parsed = true;
+    return params;
+  }
+
+  Statistics GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+  }
+
+ private:
+  std::set<std::string> instance_elements_;
+  mutable std::mutex mutex_;
+  std::map<std::string, ParametersPtr> entries_;
+  Statistics statistics_;
+
+  // One pass over the children instead of a lookup per parameter
+  std::string Key(sdf::ElementPtr sdf) const {
+    std::string key;
+    for (sdf::ElementPtr element = sdf->GetFirstElement(); element;
+         element = element->GetNextElement()) {
+      if (instance_elements_.count(element->GetName())) continue;
+      key += element->GetName();
+      key += '=';
+      if (element->GetValue()) key += element->GetValue()->GetAsString();
+      key += ';';
+    }
+    return key;
+  }
+
+  static double Seconds(std::chrono::steady_clock::time_point from,
+                        std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+  }
+};
+
+}
+
+#endif // MMUAV_PLUGINS_SDF_PARAM_CACHE_H
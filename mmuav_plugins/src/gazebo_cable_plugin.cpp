@@ -0,0 +1,195 @@
+/*
+ * Cable between two links simulated as a lumped mass chain.
+ */
+
+#include "mmuav_plugins/gazebo_cable_plugin.h"
+
+namespace gazebo {
+
+static Eigen::Vector3d toEigen(const ignition::math::Vector3d& v) {
+  return Eigen::Vector3d(v.X(), v.Y(), v.Z());
+}
+
+static ignition::math::Vector3d toIgnition(const Eigen::Vector3d& v) {
+  return ignition::math::Vector3d(v.x(), v.y(), v.z());
+}
+
+GazeboCablePlugin::~GazeboCablePlugin() {
+  SnapshotRegistry::Instance().Unregister(this);
+  updateConnection_.reset();
+  if (node_handle_) {
+    node_handle_->shutdown();
+    delete node_handle_;
+  }
+}
+
+void GazeboCablePlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
+  model_ = _model;
+
+  getSdfParam<std::string>(_sdf, "robotNamespace", namespace_, "");
+  node_handle_ = new ros::NodeHandle(namespace_);
+
+  getSdfParam<std::string>(_sdf, "parentLink", parent_link_name_, "base_link");
+  parent_link_ = model_->GetLink(parent_link_name_);
+  if (parent_link_ == NULL)
+    gzthrow("[gazebo_cable_plugin] Couldn't find specified link \"" << parent_link_name_ << "\".");
+  getSdfParam<std::string>(_sdf, "childLink", child_link_name_, "load");
+
+  getSdfParam<ignition::math::Vector3d>(_sdf, "parentOffset", parent_offset_,
+                                        ignition::math::Vector3d::Zero);
+  getSdfParam<ignition::math::Vector3d>(_sdf, "childOffset", child_offset_,
+                                        ignition::math::Vector3d::Zero);
+
+  CableModel::Parameters params;
+  getSdfParam<double>(_sdf, "length", params.length, params.length);
+  getSdfParam<double>(_sdf, "mass", params.mass, params.mass);
+  getSdfParam<int>(_sdf, "segments", params.segments, params.segments);
+  getSdfParam<double>(_sdf, "stiffness", params.stiffness, params.stiffness);
+  getSdfParam<double>(_sdf, "damping", params.damping, params.damping);
+  getSdfParam<double>(_sdf, "lateralDamping", params.lateral_damping, params.lateral_damping);
+  getSdfParam<int>(_sdf, "maxSubsteps", max_substeps_, max_substeps_);
+  params.gravity = toEigen(model_->GetWorld()->Gravity());
+  cable_.Configure(params);
+
+  double step_size = model_->GetWorld()->Physics()->GetMaxStepSize();
+  if (cable_.Substeps(step_size) > max_substeps_)
+    gzwarn << "[gazebo_cable_plugin] Cable needs " << cable_.Substeps(step_size)
+           << " substeps per physics step, more than maxSubsteps. Lower the "
+           << "stiffness or raise maxSubsteps, the cable may be unstable.\n";
+
+  getSdfParam<std::string>(_sdf, "parentWrenchPubTopic", parent_wrench_pub_topic_,
+                           parent_wrench_pub_topic_);
+  getSdfParam<std::string>(_sdf, "childWrenchPubTopic", child_wrench_pub_topic_,
+                           child_wrench_pub_topic_);
+  getSdfParam<double>(_sdf, "wrenchPublishRate", wrench_publish_rate_, wrench_publish_rate_);
+  if (!parent_wrench_pub_topic_.empty())
+    parent_wrench_pub_ =
+        node_handle_->advertise<geometry_msgs::WrenchStamped>(parent_wrench_pub_topic_, 1);
+  if (!child_wrench_pub_topic_.empty())
+    child_wrench_pub_ =
+        node_handle_->advertise<geometry_msgs::WrenchStamped>(child_wrench_pub_topic_, 1);
+
+  // Listen to the update event. This event is broadcast every
+  // simulation iteration.
+  updateConnection_ = event::Events::ConnectWorldUpdateBegin(
+      boost::bind(&GazeboCablePlugin::OnUpdate, this, _1));
+
+  SnapshotRegistry::Instance().Register(this);
+}
+
+void GazeboCablePlugin::Reset() {
+  // Cable is laid out again on the next update
+  cable_.Clear();
+  prev_sim_time_ = 0.0;
+  last_publish_time_ = 0.0;
+}
+
+std::string GazeboCablePlugin::SnapshotId() const {
+  return model_->GetName() + "/" + GetHandle();
+}
+
+// Node count, then position and velocity of every node. A cable that has
+// not been laid out yet has no nodes.
+void GazeboCablePlugin::SaveState(StateWriter& writer) const {
+  const std::vector<Eigen::Vector3d>& position = cable_.Positions();
+  const std::vector<Eigen::Vector3d>& velocity = cable_.Velocities();
+  writer.Write(uint32_t(cable_.Initialized() ? position.size() : 0));
+  if (!cable_.Initialized()) return;
+  for (size_t i = 0; i < position.size(); i++) {
+    for (int j = 0; j < 3; j++) writer.Write(position[i][j]);
+    for (int j = 0; j < 3; j++) writer.Write(velocity[i][j]);
+  }
+}
+
+bool GazeboCablePlugin::RestoreState(StateReader& reader) {
+  uint32_t nodes;
+  if (!reader.Read(&nodes)) return false;
+  if (nodes == 0) {
+    cable_.Clear();
+    return true;
+  }
+  std::vector<Eigen::Vector3d> position(nodes), velocity(nodes);
+  for (uint32_t i = 0; i < nodes; i++) {
+    for (int j = 0; j < 3; j++) {
+      if (!reader.Read(&position[i][j])) return false;
+    }
+    for (int j = 0; j < 3; j++) {
+      if (!reader.Read(&velocity[i][j])) return false;
+    }
+  }
+  // The simulation time is not part of the snapshot, the next step starts
+  // from the restored end points, which match the restored links
+  return cable_.SetState(position, velocity);
+}
+
+bool GazeboCablePlugin::FindChildLink() {
+  if (child_link_) return true;
+  child_link_ = model_->GetLink(child_link_name_);
+  if (!child_link_)
+    child_link_ = boost::dynamic_pointer_cast<physics::Link>(
+        model_->GetWorld()->EntityByName(child_link_name_));
+  return child_link_ != NULL;
+}
+
+void GazeboCablePlugin::OnUpdate(const common::UpdateInfo& _info) {
+  // Load model may be spawned after the UAV
+  if (!FindChildLink()) return;
+
+  double dt = _info.simTime.Double() - prev_sim_time_;
+  prev_sim_time_ = _info.simTime.Double();
+
+  ignition::math::Vector3d parent_point =
+      parent_link_->WorldPose().CoordPositionAdd(parent_offset_);
+  ignition::math::Vector3d child_point =
+      child_link_->WorldPose().CoordPositionAdd(child_offset_);
+  if (!cable_.Initialized() || dt <= 0.0) {
+    cable_.Reset(toEigen(parent_point), toEigen(child_point));
+    return;
+  }
+
+  Eigen::Vector3d parent_force, child_force;
+  cable_.Step(dt, max_substeps_,
+              toEigen(parent_point), toEigen(parent_link_->WorldLinearVel(parent_offset_)),
+              toEigen(child_point), toEigen(child_link_->WorldLinearVel(child_offset_)),
+              &parent_force, &child_force);
+
+  parent_link_->AddForceAtWorldPosition(toIgnition(parent_force), parent_point);
+  child_link_->AddForceAtWorldPosition(toIgnition(child_force), child_point);
+
+  if (wrench_publish_rate_ > 0.0 &&
+      prev_sim_time_ - last_publish_time_ >= 1.0 / wrench_publish_rate_) {
+    last_publish_time_ = prev_sim_time_;
+    PublishWrench(parent_wrench_pub_, parent_link_, parent_point,
+                  toIgnition(parent_force), _info.simTime);
+    PublishWrench(child_wrench_pub_, child_link_, child_point,
+                  toIgnition(child_force), _info.simTime);
+  }
+}
+
+void GazeboCablePlugin::PublishWrench(const ros::Publisher& pub,
+                                      const physics::LinkPtr& link,
+                                      const ignition::math::Vector3d& attachment,
+                                      const ignition::math::Vector3d& force,
+                                      const common::Time& stamp) {
+  if (!pub) return;
+
+  // Wrench about the link origin, in the link frame
+  ignition::math::Pose3d pose = link->WorldPose();
+  ignition::math::Vector3d torque = (attachment - pose.Pos()).Cross(force);
+  ignition::math::Vector3d force_L = pose.Rot().RotateVectorReverse(force);
+  ignition::math::Vector3d torque_L = pose.Rot().RotateVectorReverse(torque);
+
+  geometry_msgs::WrenchStamped msg;
+  msg.header.stamp = ros::Time(stamp.sec, stamp.nsec);
+  msg.header.frame_id = link->GetName();
+  msg.wrench.force.x = force_L.X();
+  msg.wrench.force.y = force_L.Y();
+  msg.wrench.force.z = force_L.Z();
+  msg.wrench.torque.x = torque_L.X();
+  msg.wrench.torque.y = torque_L.Y();
+  msg.wrench.torque.z = torque_L.Z();
+  pub.publish(msg);
+}
+
+GZ_REGISTER_MODEL_PLUGIN(GazeboCablePlugin);
+}
@@ -3,8 +3,24 @@
 
 namespace gazebo {
 
+namespace {
+// Rotor parameters shared by every motor model in the server. The elements
+// listed differ between rotors of one vehicle type and are not in the key.
+SdfParamCache<DuctedFanParameters>& ParameterCache() {
+  static SdfParamCache<DuctedFanParameters> cache({
+      "robotNamespace", "jointName", "linkName", "motorNumber",
+      "turningDirection", "commandSubTopic", "windSpeedSubTopic",
+      "motorSpeedPubTopic", "motorVelocityTopic",
+      "angleControlFlapRefSubTopic", "angleControlFlapCommandPubTopic",
+      "angleControlFlapValueSubTopic"});
+  return cache;
+}
+}
+
 GazeboMotorModel::~GazeboMotorModel() {
   updateConnection_.reset();
+  ParallelUpdateRegistry::Instance().Unregister(this);
+  SnapshotRegistry::Instance().Unregister(this);
   if (node_handle_) {
     node_handle_->shutdown();
     delete node_handle_;
@@ -17,7 +33,7 @@ void GazeboMotorModel::Publish() {
   turning_velocity_msg_.data = joint_->GetVelocity(0);
   motor_velocity_pub_.publish(turning_velocity_msg_);
 
-  angle_control_flap_command_msg_.data = angle_control_flap_ref_;
+  angle_control_flap_command_msg_.data = step_angle_control_flap_ref_;
   angle_control_flap_command_pub_.publish(angle_control_flap_command_msg_);  
 }
 
@@ -49,6 +65,11 @@ void GazeboMotorModel::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[gazebo_motor_model] Couldn't find specified link \"" << link_name_ << "\".");
+  // Rotor frame in the parent link frame, from the rotor pose at rest. The
+  // rotor link itself spins about the rotor axis.
+  physics::LinkPtr parent_link = link_->GetParentJointsLinks().at(0);
+  rotor_orientation_P_ = parent_link->InitialRelativePose().Rot().Inverse() *
+                         link_->InitialRelativePose().Rot();
 
 
   if (_sdf->HasElement("motorNumber"))
@@ -82,54 +103,29 @@ void GazeboMotorModel::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
                            angle_control_flap_value_sub_topic_);
 
 
-  getSdfParam<double>(_sdf, "rotorDragCoefficient", rotor_drag_coefficient_, rotor_drag_coefficient_);
-  getSdfParam<double>(_sdf, "rollingMomentCoefficient", rolling_moment_coefficient_,
-                      rolling_moment_coefficient_);
-  getSdfParam<double>(_sdf, "maxRotVelocity", max_rot_velocity_, max_rot_velocity_);
-  getSdfParam<double>(_sdf, "motorConstant", motor_constant_, motor_constant_);
-  getSdfParam<double>(_sdf, "momentConstant", moment_constant_, moment_constant_);
-
-  getSdfParam<double>(_sdf, "timeConstantUp", time_constant_up_, time_constant_up_);
-  getSdfParam<double>(_sdf, "timeConstantDown", time_constant_down_, time_constant_down_);
-  getSdfParam<double>(_sdf, "rotorVelocitySlowdownSim", rotor_velocity_slowdown_sim_, 10);
-
-  getSdfParam<double>(_sdf, "fluidDensity", fluid_density_, fluid_density_);
-  getSdfParam<double>(_sdf, "areaControlFlap", area_control_flap_, area_control_flap_);
-  getSdfParam<double>(_sdf, "areaAntitorqueFlap", area_antitorque_flap_, area_antitorque_flap_);
-  getSdfParam<double>(_sdf, "distanceControlFlap", distance_control_flap_, distance_control_flap_);
-  getSdfParam<double>(_sdf, "distanceAntitorqueFlap", distance_antitorque_flap_, distance_antitorque_flap_);
-
-  getSdfParam<double>(_sdf, "thrustCoefficient", thrust_coefficient_, thrust_coefficient_);
-  getSdfParam<double>(_sdf, "torqueCoefficient", torque_coefficient_, torque_coefficient_);
-  getSdfParam<double>(_sdf, "slipVelocityCoefficient", slip_velocity_coefficient_, slip_velocity_coefficient_);
+  bool parsed;
+  params_ = ParameterCache().Get(_sdf, &GazeboMotorModel::ParseParameters, &parsed);
+  SdfParamCache<DuctedFanParameters>::Statistics statistics = ParameterCache().GetStatistics();
+  if (parsed || statistics.lookups % kParameterCacheReportInterval == 0)
+    gzmsg << "[gazebo_motor_model] " << statistics.lookups << " rotors loaded, "
+          << statistics.entries << " parameter sets, " << statistics.hits << " cache hits, "
+          << (statistics.key_time + statistics.parse_time) * 1e3 << " ms spent on parameters\n";
 
-  getSdfParam<double>(_sdf, "liftCoefficientControlFlap", lift_coefficient_control_flap_, lift_coefficient_control_flap_);
-  getSdfParam<double>(_sdf, "dragCoefficientControlFlap", drag_coefficient_control_flap_, drag_coefficient_control_flap_);
-  getSdfParam<double>(_sdf, "liftCoefficientAntitorqueFlap", lift_coefficient_antitorque_flap_, lift_coefficient_antitorque_flap_);
-  getSdfParam<double>(_sdf, "dragCoefficientAntitorqueFlap", drag_coefficient_antitorque_flap_, drag_coefficient_antitorque_flap_);
-
-  getSdfParam<double>(_sdf, "liftCoefficientControlFlapAt0", lift_coefficient_control_flap_at0_, lift_coefficient_control_flap_at0_);
-  getSdfParam<double>(_sdf, "dragCoefficientControlFlapAt0", drag_coefficient_control_flap_at0_, drag_coefficient_control_flap_at0_);
-  getSdfParam<double>(_sdf, "liftCoefficientAntitorqueFlapAt0", lift_coefficient_antitorque_flap_at0_, lift_coefficient_antitorque_flap_at0_);
-  getSdfParam<double>(_sdf, "dragCoefficientAntitorqueFlapAt0", drag_coefficient_antitorque_flap_at0_, drag_coefficient_antitorque_flap_at0_);
-
-
-  //std::cout << "fluid density " <<fluid_density_ << std::endl;
-  // std::cout << area_control_flap_ << std::endl;
-  // std::cout << area_antitorque_flap_ << std::endl;
-  // std::cout << distance_control_flap_ << std::endl;
-  // std::cout << distance_antitorque_flap_ << std::endl;
-  // std::cout << thrust_coefficient_ << std::endl;
-  // std::cout << torque_coefficient_ << std::endl;
-  // std::cout << slip_velocity_coefficient_ << std::endl;
-  // std::cout << lift_coefficient_control_flap_ << std::endl;
-  // std::cout << drag_coefficient_control_flap_ << std::endl;
-  // std::cout << drag_coefficient_control_flap_at0_ << std::endl;
-  // std::cout << lift_coefficient_antitorque_flap_at0_ << std::endl;
-  // std::cout << drag_coefficient_antitorque_flap_at0_ << std::endl;
-
-  //std::cout << "angle_control_flap_sub_topic_" << angle_control_flap_sub_topic_ << std::endl;  
+  if (motor_number_ == 0 || motor_number_ == 2) { // we assume there is only one control flap wing beneath the rotor
+    flag_x = 1;
+    flag_y = 0;
+  }
+  else if (motor_number_ == 1 || motor_number_ == 3) {
+    flag_x = 0;
+    flag_y = 1;
+  }
+  else {
+    flag_x = 0;
+    flag_y = 0;
+    gzerr << "[gazebo_motor_model] Please specify a motorNumber.\n";
+  }
 
+  LoadProximityEffect(_sdf);
 
   // Set the maximumForce on the joint. This is deprecated from V5 on, and the joint won't move.
 #if GAZEBO_MAJOR_VERSION < 5
@@ -152,26 +148,268 @@ void GazeboMotorModel::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   angle_control_flap_value_sub_ = node_handle_->subscribe(angle_control_flap_value_sub_topic_, 1, &GazeboMotorModel::AngleControlFlapValueCallback, this);
   
   // Create the first order filter.
-  rotor_velocity_filter_.reset(new FirstOrderFilter<double>(time_constant_up_, time_constant_down_, ref_motor_rot_vel_));
+  rotor_velocity_filter_.reset(new FirstOrderFilter<double>(params_->time_constant_up, params_->time_constant_down,
+                                                            ref_motor_rot_vel_));
+
+  ParallelUpdateRegistry::Instance().Register(this);
+  SnapshotRegistry::Instance().Register(this);
+}
+
+// Called on world and model resets.
+void GazeboMotorModel::Reset() {
+  {
+    boost::mutex::scoped_lock lock(input_mutex_);
+    ref_motor_rot_vel_ = 0.0;
+    angle_control_flap_ = 0.0;
+    angle_control_flap_ref_ = 0.0;
+    wind_speed_W_ = ignition::math::Vector3<double>::Zero;
+  }
+  motor_rot_vel_ = 0.0;
+  prev_sim_time_ = 0.0;
+  angle_antitorque_flap_ = 0.0;
+  step_ref_motor_rot_vel_ = 0.0;
+  step_angle_control_flap_ = 0.0;
+  step_angle_control_flap_ref_ = 0.0;
+  step_wind_speed_W_ = ignition::math::Vector3<double>::Zero;
+  force_W_ = ignition::math::Vector3<double>::Zero;
+  torque_W_ = ignition::math::Vector3<double>::Zero;
+  joint_velocity_command_ = 0.0;
+  rotor_velocity_filter_->setState(0.0);
+  proximity_update_time_ = -1.0;
+  thrust_scale_ = 1.0;
+}
+
+std::string GazeboMotorModel::SnapshotId() const {
+  return model_->GetName() + "/" + GetHandle();
+}
+
+void GazeboMotorModel::SaveState(StateWriter& writer) const {
+  boost::mutex::scoped_lock lock(input_mutex_);
+  writer.Write(motor_rot_vel_);
+  writer.Write(ref_motor_rot_vel_);
+  writer.Write(sampling_time_);
+  writer.Write(rotor_velocity_filter_->getState());
+  writer.Write(angle_control_flap_);
+  writer.Write(angle_antitorque_flap_);
+  writer.Write(angle_control_flap_ref_);
+  writer.Write(wind_speed_W_.X());
+  writer.Write(wind_speed_W_.Y());
+  writer.Write(wind_speed_W_.Z());
+  writer.Write(joint_velocity_command_);
+}
+
+bool GazeboMotorModel::RestoreState(StateReader& reader) {
+  boost::mutex::scoped_lock lock(input_mutex_);
+  double filter_state, wind_x, wind_y, wind_z;
+  if (!reader.Read(&motor_rot_vel_) || !reader.Read(&ref_motor_rot_vel_) ||
+      !reader.Read(&sampling_time_) || !reader.Read(&filter_state) ||
+      !reader.Read(&angle_control_flap_) || !reader.Read(&angle_antitorque_flap_) ||
+      !reader.Read(&angle_control_flap_ref_) || !reader.Read(&wind_x) ||
+      !reader.Read(&wind_y) || !reader.Read(&wind_z) || !reader.Read(&joint_velocity_command_))
+    return false;
+  rotor_velocity_filter_->setState(filter_state);
+  wind_speed_W_.Set(wind_x, wind_y, wind_z);
+  // The simulation time is not part of the snapshot, the next step reuses
+  // the saved sampling time. The surfaces are queried again for the
+  // restored pose.
+  prev_sim_time_ = -1.0;
+  proximity_update_time_ = -1.0;
+  return true;
+}
+
+void GazeboMotorModel::ParseParameters(sdf::ElementPtr sdf, DuctedFanParameters* params) {
+  getSdfParam<double>(sdf, "rotorDragCoefficient", params->rotor_drag_coefficient,
+                      params->rotor_drag_coefficient);
+  getSdfParam<double>(sdf, "rollingMomentCoefficient", params->rolling_moment_coefficient,
+                      params->rolling_moment_coefficient);
+  getSdfParam<double>(sdf, "maxRotVelocity", params->max_rot_velocity, params->max_rot_velocity);
+  getSdfParam<double>(sdf, "motorConstant", params->motor_constant, params->motor_constant);
+  getSdfParam<double>(sdf, "momentConstant", params->moment_constant, params->moment_constant);
+  getSdfParam<double>(sdf, "timeConstantUp", params->time_constant_up, params->time_constant_up);
+  getSdfParam<double>(sdf, "timeConstantDown", params->time_constant_down,
+                      params->time_constant_down);
+  getSdfParam<double>(sdf, "rotorVelocitySlowdownSim", params->rotor_velocity_slowdown_sim,
+                      params->rotor_velocity_slowdown_sim);
+  getSdfParam<double>(sdf, "fluidDensity", params->fluid_density, params->fluid_density);
+  getSdfParam<double>(sdf, "areaControlFlap", params->area_control_flap, params->area_control_flap);
+  getSdfParam<double>(sdf, "areaAntitorqueFlap", params->area_antitorque_flap,
+                      params->area_antitorque_flap);
+  getSdfParam<double>(sdf, "distanceControlFlap", params->distance_control_flap,
+                      params->distance_control_flap);
+  getSdfParam<double>(sdf, "distanceAntitorqueFlap", params->distance_antitorque_flap,
+                      params->distance_antitorque_flap);
+  getSdfParam<double>(sdf, "thrustCoefficient", params->thrust_coefficient,
+                      params->thrust_coefficient);
+  getSdfParam<double>(sdf, "torqueCoefficient", params->torque_coefficient,
+                      params->torque_coefficient);
+  getSdfParam<double>(sdf, "slipVelocityCoefficient", params->slip_velocity_coefficient,
+                      params->slip_velocity_coefficient);
+  getSdfParam<double>(sdf, "liftCoefficientControlFlap", params->lift_coefficient_control_flap,
+                      params->lift_coefficient_control_flap);
+  getSdfParam<double>(sdf, "dragCoefficientControlFlap", params->drag_coefficient_control_flap,
+                      params->drag_coefficient_control_flap);
+  getSdfParam<double>(sdf, "liftCoefficientAntitorqueFlap", params->lift_coefficient_antitorque_flap,
+                      params->lift_coefficient_antitorque_flap);
+  getSdfParam<double>(sdf, "dragCoefficientAntitorqueFlap", params->drag_coefficient_antitorque_flap,
+                      params->drag_coefficient_antitorque_flap);
+  getSdfParam<double>(sdf, "liftCoefficientControlFlapAt0", params->lift_coefficient_control_flap_at0,
+                      params->lift_coefficient_control_flap_at0);
+  getSdfParam<double>(sdf, "dragCoefficientControlFlapAt0", params->drag_coefficient_control_flap_at0,
+                      params->drag_coefficient_control_flap_at0);
+  getSdfParam<double>(sdf, "liftCoefficientAntitorqueFlapAt0", params->lift_coefficient_antitorque_flap_at0,
+                      params->lift_coefficient_antitorque_flap_at0);
+  getSdfParam<double>(sdf, "dragCoefficientAntitorqueFlapAt0", params->drag_coefficient_antitorque_flap_at0,
+                      params->drag_coefficient_antitorque_flap_at0);
 }
 
-// This gets called by the world update start event.
+// This gets called by the world update start event. With the parallel
+// update world plugin loaded the phases are run from there instead.
 void GazeboMotorModel::OnUpdate(const common::UpdateInfo& _info) {
-  sampling_time_ = _info.simTime.Double() - prev_sim_time_;
+  if (!ParallelUpdateRegistry::Instance().Driven())
+    UpdateSerial(_info);
+}
+
+void GazeboMotorModel::ReadState(const common::UpdateInfo& _info) {
+  if (prev_sim_time_ >= 0.0)
+    sampling_time_ = _info.simTime.Double() - prev_sim_time_;
   prev_sim_time_ = _info.simTime.Double();
+  motor_rot_vel_ = joint_->GetVelocity(0);
+  if (motor_rot_vel_ / (2 * M_PI) > 1 / (2 * sampling_time_)) {
+    gzerr << "Aliasing on motor [" << motor_number_ << "] might occur. Consider making smaller simulation time steps or raising the rotor_velocity_slowdown_sim_ param.\n";
+  }
+
+  {
+    boost::mutex::scoped_lock lock(input_mutex_);
+    step_ref_motor_rot_vel_ = ref_motor_rot_vel_;
+    step_wind_speed_W_ = wind_speed_W_;
+    step_angle_control_flap_ = angle_control_flap_;
+    step_angle_control_flap_ref_ = angle_control_flap_ref_;
+  }
+
+  joint_axis_W_ = joint_->GlobalAxis(0);
+  body_velocity_W_ = link_->WorldLinearVel();
+  // Getting the parent link, such that the resulting torques can be applied to it.
+  parent_link_ = link_->GetParentJointsLinks().at(0);
+  // Orientation of the rotor frame, tilted rotors and vehicles included,
+  // without the spin of the rotor link
+  rotor_orientation_W_ = parent_link_->WorldPose().Rot() * rotor_orientation_P_;
+
+  if (proximity_ray_ && (proximity_update_time_ < 0.0 ||
+                         _info.simTime.Double() - proximity_update_time_ >= proximity_update_period_)) {
+    UpdateProximityEffect();
+    proximity_update_time_ = _info.simTime.Double();
+  }
+}
+
+void GazeboMotorModel::Compute() {
   UpdateForcesAndMoments();
+}
+
+// One force on the rotor and one torque on its parent, both in the world
+// frame.
+void GazeboMotorModel::ApplyWrench() {
+  link_->AddForce(force_W_);
+  parent_link_->AddTorque(torque_W_);
+  joint_->SetVelocity(0, joint_velocity_command_);
   Publish();
 }
 
+void GazeboMotorModel::LoadProximityEffect(sdf::ElementPtr sdf) {
+  bool enabled = false;
+  getSdfParam<bool>(sdf, "proximityEffect", enabled, enabled);
+  if (!enabled)
+    return;
+
+  double update_rate = kDefaultProximityUpdateRate;
+  double range = kDefaultProximityRange;
+  double wall_coefficient = kDefaultWallEffectCoefficient;
+  std::string ground_points, wall_points;
+  getSdfParam<double>(sdf, "rotorRadius", rotor_radius_, rotor_radius_);
+  getSdfParam<double>(sdf, "proximityUpdateRate", update_rate, update_rate);
+  getSdfParam<double>(sdf, "proximityRange", range, range);
+  getSdfParam<double>(sdf, "wallEffectCoefficient", wall_coefficient, wall_coefficient);
+  getSdfParam<std::string>(sdf, "groundEffectTable", ground_points, ground_points);
+  getSdfParam<std::string>(sdf, "wallEffectTable", wall_points, wall_points);
+  if (update_rate <= 0.0) {
+    gzerr << "[gazebo_motor_model] proximityUpdateRate must be positive, using "
+          << kDefaultProximityUpdateRate << " Hz.\n";
+    update_rate = kDefaultProximityUpdateRate;
+  }
+  proximity_update_period_ = 1.0 / update_rate;
+
+  ground_effect_table_ = ProximityTable(range);
+  if (ground_points.empty())
+    ground_effect_table_.Sample(GroundEffectFactor);
+  else if (!ground_effect_table_.SetPoints(ground_points))
+    gzerr << "[gazebo_motor_model] Invalid groundEffectTable, use increasing \"distance factor\" pairs.\n";
+  wall_effect_table_ = ProximityTable(range);
+  if (wall_points.empty())
+    wall_effect_table_.Sample([wall_coefficient](double distance) {
+      return WallEffectFactor(distance, wall_coefficient);
+    });
+  else if (!wall_effect_table_.SetPoints(wall_points))
+    gzerr << "[gazebo_motor_model] Invalid wallEffectTable, use increasing \"distance factor\" pairs.\n";
+
+  proximity_ray_ = boost::dynamic_pointer_cast<physics::RayShape>(
+      model_->GetWorld()->Physics()->CreateShape("ray", physics::CollisionPtr()));
+}
+
+// Runs on the update thread in both update modes, the rays query the
+// collision space of the physics engine. One ray along the downwash for
+// the ground, four in the rotor plane for walls.
+void GazeboMotorModel::UpdateProximityEffect() {
+  double range = ground_effect_table_.Range() * rotor_radius_;
+  ignition::math::Vector3<double> origin = link_->WorldCoGPose().Pos();
+  ignition::math::Vector3<double> axis = joint_axis_W_.Normalized();
+  // The in plane directions follow the parent link, the rotor link spins.
+  ignition::math::Quaternion<double> parent_orientation = parent_link_->WorldPose().Rot();
+  ignition::math::Vector3<double> side = parent_orientation.XAxis() - parent_orientation.XAxis().Dot(axis) * axis;
+  if (side.Length() < 1e-3)
+    side = parent_orientation.YAxis() - parent_orientation.YAxis().Dot(axis) * axis;
+  side.Normalize();
+  ignition::math::Vector3<double> other_side = axis.Cross(side);
+
+  double ground_distance = SurfaceDistance(origin, -axis, range);
+  double wall_distance = std::min(std::min(SurfaceDistance(origin, side, range),
+                                           SurfaceDistance(origin, -side, range)),
+                                  std::min(SurfaceDistance(origin, other_side, range),
+                                           SurfaceDistance(origin, -other_side, range)));
+  thrust_scale_ = ground_effect_table_.Lookup(ground_distance / rotor_radius_) *
+                  wall_effect_table_.Lookup(wall_distance / rotor_radius_);
+}
+
+// Distance along direction to the first surface that is not part of this
+// vehicle, range if there is none within it.
+double GazeboMotorModel::SurfaceDistance(const ignition::math::Vector3<double>& origin,
+                                         const ignition::math::Vector3<double>& direction, double range) {
+  const std::string own_prefix = model_->GetScopedName() + "::";
+  double start = 0.0;
+  for (int i = 0; i < kMaxProximityRayHits && start < range; i++) {
+    double distance;
+    std::string entity;
+    proximity_ray_->SetPoints(origin + direction * start, origin + direction * range);
+    proximity_ray_->GetIntersection(distance, entity);
+    if (entity.empty())
+      return range;
+    if (entity.compare(0, own_prefix.size(), own_prefix) != 0)
+      return std::min(start + distance, range);
+    // Restart behind the own collision, the ray may start inside of it
+    start += distance + kProximityRaySkip;
+  }
+  return range;
+}
+
 void GazeboMotorModel::VelocityCallback(const mav_msgs::ActuatorsConstPtr& rot_velocities) {
   ROS_ASSERT_MSG(rot_velocities->angular_velocities.size() > motor_number_,
                  "You tried to access index %d of the MotorSpeed message array which is of size %d.",
                  motor_number_, rot_velocities->angular_velocities.size());
-  ref_motor_rot_vel_ = std::min(rot_velocities->angular_velocities[motor_number_], max_rot_velocity_);
+  boost::mutex::scoped_lock lock(input_mutex_);
+  ref_motor_rot_vel_ = std::min(rot_velocities->angular_velocities[motor_number_], params_->max_rot_velocity);
 }
 
 void GazeboMotorModel::WindSpeedCallback(const rotors_comm::WindSpeedConstPtr& wind_speed) {
   // TODO(burrimi): Transform velocity to world frame if frame_id is set to something else.
+  boost::mutex::scoped_lock lock(input_mutex_);
   wind_speed_W_.X(wind_speed->velocity.x);
   wind_speed_W_.Y(wind_speed->velocity.y);
   wind_speed_W_.Z(wind_speed->velocity.z);
@@ -179,132 +417,49 @@ void GazeboMotorModel::WindSpeedCallback(const rotors_comm::WindSpeedConstPtr& w
 }
 
 void GazeboMotorModel::AngleControlFlapRefCallback(const std_msgs::Float32Ptr& angle){
+	boost::mutex::scoped_lock lock(input_mutex_);
 	angle_control_flap_ref_ = angle->data;
 	//std::cout << "angle_control_flap_ref_1 " << angle_control_flap_ref_ << std::endl;
 }
 
 void GazeboMotorModel::AngleControlFlapValueCallback(const control_msgs::JointControllerStatePtr& msg){
+	boost::mutex::scoped_lock lock(input_mutex_);
 	angle_control_flap_ = msg->process_value;
 	//std::cout << "angle_control_flap_value_1 " << angle_control_flap_ << std::endl;
 }
 
 
-void GazeboMotorModel::UpdateForcesAndMoments() {	
-  motor_rot_vel_ = joint_->GetVelocity(0);
-  if (motor_rot_vel_ / (2 * M_PI) > 1 / (2 * sampling_time_)) {
-    gzerr << "Aliasing on motor [" << motor_number_ << "] might occur. Consider making smaller simulation time steps or raising the rotor_velocity_slowdown_sim_ param.\n";
-  }
-  double real_motor_velocity = motor_rot_vel_ * rotor_velocity_slowdown_sim_;
-  double force = real_motor_velocity * real_motor_velocity * motor_constant_;
-  // Apply a force to the link.
-  //link_->AddRelativeForce(math::Vector3(0, 0, force));
-
-
-  //Ducted fan formulas
-
-  if (motor_number_ == 0 || motor_number_ == 2) { // we assume there is only one control flap wing beneath the rotor
-    flag_x = 1;
-    flag_y = 0;
-  }
-  else if (motor_number_ == 1 || motor_number_ == 3) {
-    flag_x = 0;
-    flag_y = 1;
-  }
-  else {
-    gzerr << "[gazebo_motor_model] Please specify a motorNumber.\n";
-  }
-
-  if (angle_control_flap_ > 0.3 || angle_control_flap_ < -0.3){ // maximum angle value is 15 deg (0.26179 rad)
-  	angle_control_flap_ = 0; // values before the morus_control.launch are large and incorrect and cause problems with forces
-  }
-
-
-  angle_antitorque_flap_ = 0; //antitorque flaps for single rotor vehicles can be added easily, decided not to use them
-  double slip_velocity_squared_ = real_motor_velocity * real_motor_velocity * slip_velocity_coefficient_;
-  
+// Runs on a worker thread when driven by the parallel update plugin, works
+// on the state copied by ReadState only.
+void GazeboMotorModel::UpdateForcesAndMoments() {
+  const DuctedFanParameters& p = *params_;
+  double real_motor_velocity = motor_rot_vel_ * p.rotor_velocity_slowdown_sim;
+
+  //antitorque flaps for single rotor vehicles can be added easily, decided not to use them
+  angle_antitorque_flap_ = 0;
+
+  ignition::math::Vector3<double> relative_wind_velocity_W = body_velocity_W_ - step_wind_speed_W_;
+  ignition::math::Vector3<double> body_velocity_perpendicular = relative_wind_velocity_W - (relative_wind_velocity_W.Dot(joint_axis_W_) * joint_axis_W_);
+  const double airspeed_perpendicular[3] = {body_velocity_perpendicular.X(), body_velocity_perpendicular.Y(),
+                                            body_velocity_perpendicular.Z()};
+  DuctedFanWrench wrench = EvaluateDuctedFan(p, real_motor_velocity, step_angle_control_flap_, angle_antitorque_flap_,
+                                             flag_x, flag_y, turning_direction_, airspeed_perpendicular,
+                                             thrust_scale_);
+
+  // Thrust, flap forces and moments are in the rotor frame, the air drag
+  // and the rolling moment in the world frame like the airspeed.
+  ignition::math::Vector3<double> force(wrench.force[0], wrench.force[1], wrench.force[2]);
+  ignition::math::Vector3<double> moment(wrench.moment[0], wrench.moment[1], wrench.moment[2]);
+  force_W_ = rotor_orientation_W_.RotateVector(force) +
+             ignition::math::Vector3<double>(wrench.air_drag[0], wrench.air_drag[1], wrench.air_drag[2]);
+  torque_W_ = rotor_orientation_W_.RotateVector(moment) +
+              ignition::math::Vector3<double>(wrench.rolling_moment[0], wrench.rolling_moment[1],
+                                              wrench.rolling_moment[2]);
 
-  double force_x_ = fluid_density_ * area_control_flap_ * slip_velocity_squared_ * 
-  lift_coefficient_control_flap_ * angle_control_flap_ * flag_x;
-  double force_y_ = fluid_density_ * area_control_flap_ * slip_velocity_squared_ * 
-  lift_coefficient_control_flap_ * angle_control_flap_ * flag_y;
-  
-  double force_antitorque_flap_ = fluid_density_ * area_antitorque_flap_ * slip_velocity_squared_ * 
-  (drag_coefficient_antitorque_flap_ * angle_antitorque_flap_ * angle_antitorque_flap_ + drag_coefficient_antitorque_flap_at0_);
-  double force_thrust_ = real_motor_velocity * real_motor_velocity * thrust_coefficient_;
-  double force_control_flap_ = fluid_density_ * area_control_flap_ * slip_velocity_squared_ * 
-  (drag_coefficient_control_flap_ * angle_control_flap_ * angle_control_flap_ + drag_coefficient_control_flap_at0_);
-  double force_z_ = force_thrust_ - force_antitorque_flap_ - force_control_flap_;
-
-  
-  double moment_x_ = force_x_ * distance_control_flap_ ;
-  double moment_y_ = force_y_ * distance_control_flap_ ;
-  double moment_z_1 = - turning_direction_ * torque_coefficient_ * force_thrust_;
-  double moment_z_2 = fluid_density_ * area_antitorque_flap_ * slip_velocity_squared_*
-  (lift_coefficient_antitorque_flap_ * angle_antitorque_flap_ + lift_coefficient_antitorque_flap_at0_);
-  double moment_z_ = - turning_direction_ * torque_coefficient_ * force_thrust_ + fluid_density_ * area_antitorque_flap_ * slip_velocity_squared_* 
-  (lift_coefficient_antitorque_flap_ * angle_antitorque_flap_ + lift_coefficient_antitorque_flap_at0_);
-  //decided that the antitorque part of the formulas is not used
-
-  link_->AddForce(ignition::math::Vector3<double>(force_x_, force_y_, force_z_));
-
-
-
-
-  // Forces from Philppe Martin's and Erwan Salaün's
-  // 2010 IEEE Conference on Robotics and Automation paper
-  // The True Role of Accelerometer Feedback in Quadrotor Control
-  // - \omega * \lambda_1 * V_A^{\perp}
-  ignition::math::Vector3<double> joint_axis = joint_->GlobalAxis(0);
-  ignition::math::Vector3<double> body_velocity_W = link_->WorldLinearVel();
-  ignition::math::Vector3<double> relative_wind_velocity_W = body_velocity_W - wind_speed_W_;
-  ignition::math::Vector3<double> body_velocity_perpendicular = relative_wind_velocity_W - (relative_wind_velocity_W.Dot(joint_axis) * joint_axis);
-  ignition::math::Vector3<double> air_drag = -std::abs(real_motor_velocity) * rotor_drag_coefficient_ * body_velocity_perpendicular;
-  // Apply air_drag to link.
-  link_->AddForce(air_drag);
-  // Moments
-  // Getting the parent link, such that the resulting torques can be applied to it.
-  physics::Link_V parent_links = link_->GetParentJointsLinks();
-  // The tansformation from the parent_link to the link_.
-  ignition::math::Pose3<double> pose_difference = link_->WorldCoGPose() - parent_links.at(0)->WorldCoGPose();
-
-
-  ignition::math::Vector3<double> drag_torque(moment_x_, moment_y_, moment_z_1);
-
-
-  // Transforming the drag torque into the parent frame to handle arbitrary rotor orientations.
-  ignition::math::Vector3<double> drag_torque_parent_frame = pose_difference.Rot().RotateVector(drag_torque);
-  parent_links.at(0)->AddRelativeTorque(drag_torque_parent_frame);
-
-  ignition::math::Vector3<double> rolling_moment;
-  // - \omega * \mu_1 * V_A^{\perp}
-  rolling_moment = -std::abs(real_motor_velocity) * rolling_moment_coefficient_ * body_velocity_perpendicular;
-  parent_links.at(0)->AddTorque(rolling_moment);
   // Apply the filter on the motor's velocity.
   double ref_motor_rot_vel;
-  ref_motor_rot_vel = rotor_velocity_filter_->updateFilter(ref_motor_rot_vel_, sampling_time_);
-  joint_->SetVelocity(0, turning_direction_ * ref_motor_rot_vel / rotor_velocity_slowdown_sim_);
-
-  
-  //std::cout << "angle_control_flap_2 " << angle_control_flap_ << std::endl;
-  //std::cout << "angle_control_flap_sub_topic_" << angle_control_flap_sub_topic_ << std::endl; 
-
-  //std::cout << "motor_number_ " << motor_number_ << std::endl;
-  //std::cout << "force " << force << std::endl;
-  /*std::cout << "force_x_ " << force_x_ << std::endl; 
-  std::cout << "force_y_ " << force_y_ << std::endl;
-  std::cout << "force_z_ " << force_z_ << std::endl;
-  std::cout << "slip_velocity_squared_ " << slip_velocity_squared_ << std::endl;
-  std::cout << "force_thrust_" << force_thrust_ << std::endl;
-  std::cout << "force_control_flap_ " << force_control_flap_ << std::endl;
-  std::cout << "force_antitorque_flap_ " << force_antitorque_flap_ << std::endl;
-
-  std::cout << "drag_torque " << drag_torque << std::endl;
-  std::cout << "rolling_moment " << rolling_moment << std::endl;
-  std::cout << "moment_x_ " << moment_x_ << std::endl;
-  std::cout << "moment_y_ " << moment_y_ << std::endl;
-  std::cout << "moment_z_ " << moment_z_ << std::endl;
-  std::cout << "moment_z_1 " << moment_z_1 << std::endl;
-  std::cout << "moment_z_2 " << moment_z_2 << std::endl << std::endl;*/
+  ref_motor_rot_vel = rotor_velocity_filter_->updateFilter(step_ref_motor_rot_vel_, sampling_time_);
+  joint_velocity_command_ = turning_direction_ * ref_motor_rot_vel / p.rotor_velocity_slowdown_sim;
 }
 
 GZ_REGISTER_MODEL_PLUGIN(GazeboMotorModel);
@@ -0,0 +1,221 @@
+/*
+ * Movable masses modelled as second order servos acting on base_link.
+ */
+
+#include "mmuav_plugins/gazebo_moving_mass_plugin.h"
+
+#include <algorithm>
+
+namespace gazebo {
+
+GazeboMovingMassPlugin::~GazeboMovingMassPlugin() {
+  updateConnection_.reset();
+  ParallelUpdateRegistry::Instance().Unregister(this);
+  SnapshotRegistry::Instance().Unregister(this);
+  if (node_handle_) {
+    node_handle_->shutdown();
+    delete node_handle_;
+  }
+}
+
+void GazeboMovingMassPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
+  model_ = _model;
+
+  getSdfParam<std::string>(_sdf, "robotNamespace", namespace_, "");
+  node_handle_ = new ros::NodeHandle(namespace_);
+
+  getSdfParam<std::string>(_sdf, "linkName", link_name_, "base_link");
+  link_ = model_->GetLink(link_name_);
+  if (link_ == NULL)
+    gzthrow("[gazebo_moving_mass_plugin] Couldn't find specified link \"" << link_name_ << "\".");
+
+  getSdfParam<double>(_sdf, "mass", mass_, mass_);
+  getSdfParam<double>(_sdf, "pathLimit", path_limit_, path_limit_);
+  getSdfParam<double>(_sdf, "naturalFrequency", natural_frequency_, natural_frequency_);
+  getSdfParam<double>(_sdf, "dampingRatio", damping_ratio_, damping_ratio_);
+  getSdfParam<double>(_sdf, "maxVelocity", max_velocity_, max_velocity_);
+
+  // <movableMass><origin>x y z</origin><axis>x y z</axis></movableMass>,
+  // in the order of the command array
+  if (_sdf->HasElement("movableMass")) {
+    sdf::ElementPtr element = _sdf->GetElement("movableMass");
+    while (element) {
+      MovableMass movable_mass;
+      getSdfParam<ignition::math::Vector3d>(element, "origin", movable_mass.origin,
+                                            ignition::math::Vector3d::Zero);
+      getSdfParam<ignition::math::Vector3d>(element, "axis", movable_mass.axis,
+                                            ignition::math::Vector3d::UnitX);
+      movable_mass.axis.Normalize();
+      masses_.push_back(movable_mass);
+      element = element->GetNextElement("movableMass");
+    }
+  }
+  else
+    gzerr << "[gazebo_moving_mass_plugin] Please specify the movableMass elements.\n";
+  commands_.assign(masses_.size(), 0.0);
+  state_msg_.data.resize(masses_.size());
+  Reset();
+
+  getSdfParam<std::string>(_sdf, "commandSubTopic", command_sub_topic_, command_sub_topic_);
+  getSdfParam<std::string>(_sdf, "statePubTopic", state_pub_topic_, state_pub_topic_);
+  getSdfParam<double>(_sdf, "statePublishRate", state_publish_rate_, state_publish_rate_);
+  command_sub_ = node_handle_->subscribe(command_sub_topic_, 1,
+                                         &GazeboMovingMassPlugin::CommandCallback, this);
+  state_pub_ = node_handle_->advertise<std_msgs::Float64MultiArray>(state_pub_topic_, 1);
+  ParallelUpdateRegistry::Instance().Register(this);
+  SnapshotRegistry::Instance().Register(this);
+
+  // Listen to the update event. This event is broadcast every
+  // simulation iteration.
+  updateConnection_ = event::Events::ConnectWorldUpdateBegin(
+      boost::bind(&GazeboMovingMassPlugin::OnUpdate, this, _1));
+}
+
+void GazeboMovingMassPlugin::Reset() {
+  for (size_t i = 0; i < masses_.size(); i++) {
+    masses_[i].command = 0.0;
+    masses_[i].position = 0.0;
+    masses_[i].velocity = 0.0;
+    masses_[i].acceleration = 0.0;
+  }
+  boost::mutex::scoped_lock lock(command_mutex_);
+  std::fill(commands_.begin(), commands_.end(), 0.0);
+  prev_sim_time_ = 0.0;
+  last_publish_time_ = 0.0;
+  dt_ = 0.0;
+}
+
+std::string GazeboMovingMassPlugin::SnapshotId() const {
+  return model_->GetName() + "/" + GetHandle();
+}
+
+void GazeboMovingMassPlugin::SaveState(StateWriter& writer) const {
+  writer.Write(uint32_t(masses_.size()));
+  writer.Write(dt_);
+  for (size_t i = 0; i < masses_.size(); i++) {
+    writer.Write(masses_[i].command);
+    writer.Write(masses_[i].position);
+    writer.Write(masses_[i].velocity);
+    writer.Write(masses_[i].acceleration);
+  }
+}
+
+bool GazeboMovingMassPlugin::RestoreState(StateReader& reader) {
+  uint32_t count;
+  if (!reader.Read(&count) || count != masses_.size() || !reader.Read(&dt_))
+    return false;
+  for (size_t i = 0; i < masses_.size(); i++) {
+    if (!reader.Read(&masses_[i].command) || !reader.Read(&masses_[i].position) ||
+        !reader.Read(&masses_[i].velocity) || !reader.Read(&masses_[i].acceleration))
+      return false;
+  }
+  // Pending commands are those of the snapshot, the simulation time is not
+  // part of it and the next step reuses the saved step size.
+  boost::mutex::scoped_lock lock(command_mutex_);
+  for (size_t i = 0; i < masses_.size(); i++)
+    commands_[i] = masses_[i].command;
+  prev_sim_time_ = -1.0;
+  last_publish_time_ = 0.0;
+  return true;
+}
+
+void GazeboMovingMassPlugin::CommandCallback(const std_msgs::Float64MultiArrayConstPtr& msg) {
+  if (msg->data.size() < masses_.size()) {
+    gzwarn << "[gazebo_moving_mass_plugin] Not enough data. Length: " << msg->data.size() << "\n";
+    return;
+  }
+  boost::mutex::scoped_lock lock(command_mutex_);
+  for (size_t i = 0; i < commands_.size(); i++)
+    commands_[i] = std::max(-path_limit_, std::min(path_limit_, msg->data[i]));
+}
+
+// This gets called by the world update start event. With the parallel
+// update world plugin loaded the phases are run from there instead.
+void GazeboMovingMassPlugin::OnUpdate(const common::UpdateInfo& _info) {
+  if (!ParallelUpdateRegistry::Instance().Driven())
+    UpdateSerial(_info);
+}
+
+void GazeboMovingMassPlugin::ReadState(const common::UpdateInfo& _info) {
+  if (prev_sim_time_ >= 0.0)
+    dt_ = _info.simTime.Double() - prev_sim_time_;
+  prev_sim_time_ = _info.simTime.Double();
+  if (dt_ <= 0.0) return;
+
+  pose_ = link_->WorldPose();
+  cog_ = link_->WorldCoGPose().Pos();
+  omega_ = link_->WorldAngularVel();
+  gravity_ = model_->GetWorld()->Gravity();
+
+  boost::mutex::scoped_lock lock(command_mutex_);
+  for (size_t i = 0; i < masses_.size(); i++)
+    masses_[i].command = commands_[i];
+}
+
+void GazeboMovingMassPlugin::Compute() {
+  if (dt_ <= 0.0) return;
+  UpdateServos(dt_);
+  ComputeWrench();
+}
+
+void GazeboMovingMassPlugin::ApplyWrench() {
+  if (dt_ <= 0.0) return;
+  link_->AddForce(force_);
+  link_->AddTorque(torque_);
+
+  if (state_publish_rate_ > 0.0 &&
+      prev_sim_time_ - last_publish_time_ >= 1.0 / state_publish_rate_) {
+    last_publish_time_ = prev_sim_time_;
+    PublishState();
+  }
+}
+
+void GazeboMovingMassPlugin::UpdateServos(double dt) {
+  // x'' = wn^2 (x_ref - x) - 2 zeta wn x', semi-implicit Euler with speed
+  // and travel limits of the stepper
+  double wn2 = natural_frequency_ * natural_frequency_;
+  double d = 2.0 * damping_ratio_ * natural_frequency_;
+  for (size_t i = 0; i < masses_.size(); i++) {
+    MovableMass& m = masses_[i];
+    double velocity = m.velocity + dt * (wn2 * (m.command - m.position) - d * m.velocity);
+    velocity = std::max(-max_velocity_, std::min(max_velocity_, velocity));
+    double position = m.position + dt * velocity;
+    if (position > path_limit_ || position < -path_limit_) {
+      position = std::max(-path_limit_, std::min(path_limit_, position));
+      velocity = 0.0;
+    }
+    m.acceleration = (velocity - m.velocity) / dt;
+    m.velocity = velocity;
+    m.position = position;
+  }
+}
+
+void GazeboMovingMassPlugin::ComputeWrench() {
+  // Rigid mass at the middle of the path is simulated by the physics
+  // engine, only the effect of the displacement x along the axis is added:
+  // weight moment of the offset and the reaction to the relative
+  // acceleration, Coriolis and centripetal terms. The change of inertia is
+  // neglected.
+  force_ = ignition::math::Vector3d::Zero;
+  torque_ = ignition::math::Vector3d::Zero;
+  for (size_t i = 0; i < masses_.size(); i++) {
+    const MovableMass& m = masses_[i];
+    ignition::math::Vector3d axis = pose_.Rot().RotateVector(m.axis);
+    ignition::math::Vector3d offset = axis * m.position;
+    ignition::math::Vector3d point = pose_.CoordPositionAdd(m.origin) + offset;
+
+    ignition::math::Vector3d reaction = -mass_ * (axis * m.acceleration +
+        2.0 * omega_.Cross(axis * m.velocity) + omega_.Cross(omega_.Cross(offset)));
+    force_ += reaction;
+    torque_ += (point - cog_).Cross(reaction) + offset.Cross(mass_ * gravity_);
+  }
+}
+
+void GazeboMovingMassPlugin::PublishState() {
+  for (size_t i = 0; i < masses_.size(); i++)
+    state_msg_.data[i] = masses_[i].position;
+  state_pub_.publish(state_msg_);
+}
+
+GZ_REGISTER_MODEL_PLUGIN(GazeboMovingMassPlugin);
+}
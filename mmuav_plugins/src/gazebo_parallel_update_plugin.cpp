@@ -0,0 +1,77 @@
+/*
+ * Read state / compute / apply wrench updates of the vehicle plugins on a
+ * worker pool.
+ */
+
+#include "mmuav_plugins/gazebo_parallel_update_plugin.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace gazebo {
+
+GazeboParallelUpdatePlugin::~GazeboParallelUpdatePlugin() {
+  updateConnection_.reset();
+  ParallelUpdateRegistry::Instance().SetDriven(false);
+}
+
+void GazeboParallelUpdatePlugin::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf) {
+  int threads;
+  getSdfParam<int>(_sdf, "threads", threads, kDefaultParallelUpdateThreads);
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  getSdfParam<double>(_sdf, "statisticsPeriod", statistics_period_, statistics_period_);
+
+  pool_.reset(new WorkerPool(threads));
+  statistics_start_ = common::Time::GetWallTime();
+  ParallelUpdateRegistry::Instance().SetDriven(true);
+  gzmsg << "[gazebo_parallel_update_plugin] Updating vehicle plugins on " << threads
+        << " threads.\n";
+
+  // Listen to the update event. This event is broadcast every
+  // simulation iteration.
+  updateConnection_ = event::Events::ConnectWorldUpdateBegin(
+      boost::bind(&GazeboParallelUpdatePlugin::OnUpdate, this, _1));
+}
+
+// This gets called by the world update start event.
+void GazeboParallelUpdatePlugin::OnUpdate(const common::UpdateInfo& _info) {
+  ParallelUpdateRegistry& registry = ParallelUpdateRegistry::Instance();
+  if (registry.Version() != client_version_) {
+    client_version_ = registry.Version();
+    registry.GetClients(clients_);
+  }
+
+  common::Time start = common::Time::GetWallTime();
+  for (size_t i = 0; i < clients_.size(); i++)
+    clients_[i]->ReadState(_info);
+  common::Time read = common::Time::GetWallTime();
+  pool_->Run(clients_.size(), [this](size_t i) { clients_[i]->Compute(); });
+  common::Time computed = common::Time::GetWallTime();
+  for (size_t i = 0; i < clients_.size(); i++)
+    clients_[i]->ApplyWrench();
+  common::Time applied = common::Time::GetWallTime();
+
+  steps_++;
+  read_time_ += (read - start).Double();
+  compute_time_ += (computed - read).Double();
+  apply_time_ += (applied - computed).Double();
+  if (statistics_period_ > 0.0 && (applied - statistics_start_).Double() >= statistics_period_) {
+    ReportStatistics();
+    statistics_start_ = applied;
+  }
+}
+
+void GazeboParallelUpdatePlugin::ReportStatistics() {
+  if (steps_ > 0) {
+    gzmsg << "[gazebo_parallel_update_plugin] " << clients_.size() << " clients, "
+          << steps_ << " steps, per step: read " << read_time_ / steps_ * 1e6 << " us, compute "
+          << compute_time_ / steps_ * 1e6 << " us, apply " << apply_time_ / steps_ * 1e6
+          << " us\n";
+  }
+  steps_ = 0;
+  read_time_ = compute_time_ = apply_time_ = 0.0;
+}
+
+GZ_REGISTER_WORLD_PLUGIN(GazeboParallelUpdatePlugin);
+}
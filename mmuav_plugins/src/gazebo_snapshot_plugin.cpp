@@ -0,0 +1,169 @@
+/*
+ * Plugin and link state snapshots over a ROS service.
+ */
+
+#include "mmuav_plugins/gazebo_snapshot_plugin.h"
+
+#include <chrono>
+#include <sstream>
+
+#include <boost/thread/recursive_mutex.hpp>
+
+namespace gazebo {
+
+GazeboSnapshotPlugin::~GazeboSnapshotPlugin() {
+  SnapshotRegistry::Instance().Unregister(this);
+  if (node_handle_) {
+    node_handle_->shutdown();
+    delete node_handle_;
+  }
+}
+
+void GazeboSnapshotPlugin::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf) {
+  world_ = _world;
+
+  if (!ros::isInitialized()) {
+    gzerr << "[gazebo_snapshot_plugin] ROS is not initialized, load the gazebo_ros system plugin.\n";
+    return;
+  }
+
+  getSdfParam<std::string>(_sdf, "serviceName", service_name_, service_name_);
+  update_connection_ = event::Events::ConnectWorldUpdateEnd(
+      boost::bind(&GazeboSnapshotPlugin::OnWorldUpdateEnd, this));
+  node_handle_ = new ros::NodeHandle();
+  plugin_state_service_ = node_handle_->advertiseService(
+      service_name_, &GazeboSnapshotPlugin::PluginStateCallback, this);
+  SnapshotRegistry::Instance().Register(this);
+}
+
+std::string GazeboSnapshotPlugin::SnapshotId() const {
+  return "world/links";
+}
+
+void GazeboSnapshotPlugin::SaveState(StateWriter& writer) const {
+  std::vector<physics::LinkPtr> links;
+  physics::Model_V models = world_->Models();
+  for (size_t i = 0; i < models.size(); i++) {
+    if (models[i]->IsStatic()) continue;
+    physics::Link_V model_links = models[i]->GetLinks();
+    links.insert(links.end(), model_links.begin(), model_links.end());
+  }
+
+  writer.Write(uint32_t(links.size()));
+  for (size_t i = 0; i < links.size(); i++) {
+    ignition::math::Pose3d pose = links[i]->WorldPose();
+    ignition::math::Vector3d linear = links[i]->WorldCoGLinearVel();
+    ignition::math::Vector3d angular = links[i]->WorldAngularVel();
+    writer.Write(links[i]->GetScopedName());
+    writer.Write(pose.Pos().X());
+    writer.Write(pose.Pos().Y());
+    writer.Write(pose.Pos().Z());
+    writer.Write(pose.Rot().W());
+    writer.Write(pose.Rot().X());
+    writer.Write(pose.Rot().Y());
+    writer.Write(pose.Rot().Z());
+    writer.Write(linear.X());
+    writer.Write(linear.Y());
+    writer.Write(linear.Z());
+    writer.Write(angular.X());
+    writer.Write(angular.Y());
+    writer.Write(angular.Z());
+  }
+}
+
+bool GazeboSnapshotPlugin::RestoreState(StateReader& reader) {
+  uint32_t count;
+  if (!reader.Read(&count)) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    std::string name;
+    double v[13];
+    if (!reader.Read(&name)) return false;
+    for (int j = 0; j < 13; j++) {
+      if (!reader.Read(&v[j])) return false;
+    }
+
+    physics::LinkPtr link = boost::dynamic_pointer_cast<physics::Link>(world_->EntityByName(name));
+    if (!link) {
+      gzwarn << "[gazebo_snapshot_plugin] Link \"" << name << "\" of the snapshot does not exist.\n";
+      continue;
+    }
+    link->SetWorldPose(ignition::math::Pose3d(ignition::math::Vector3d(v[0], v[1], v[2]),
+                                              ignition::math::Quaterniond(v[3], v[4], v[5], v[6])));
+    link->SetLinearVel(ignition::math::Vector3d(v[7], v[8], v[9]));
+    link->SetAngularVel(ignition::math::Vector3d(v[10], v[11], v[12]));
+  }
+  return true;
+}
+
+// Called on a ROS spinner thread. The physics update mutex does not cover
+// the world update begin event, where the motor plugins read the link state
+// and apply their wrench, so the request is handed to the simulation thread.
+bool GazeboSnapshotPlugin::PluginStateCallback(mmuav_msgs::PluginState::Request& request,
+                                               mmuav_msgs::PluginState::Response& response) {
+  std::unique_lock<std::mutex> lock(request_mutex_);
+  request_cond_.wait(lock, [this] { return pending_ == nullptr; });
+  PendingRequest pending = {&request, &response, false};
+  pending_ = &pending;
+  while (!pending.done) {
+    if (request_cond_.wait_for(lock, std::chrono::milliseconds(100)) == std::cv_status::timeout &&
+        !pending.done && world_->IsPaused()) {
+      // A paused world does not update, nothing runs the plugins either
+      pending_ = nullptr;
+      RunRequest(request, response);
+      pending.done = true;
+    }
+  }
+  request_cond_.notify_all();
+  return true;
+}
+
+void GazeboSnapshotPlugin::OnWorldUpdateEnd() {
+  std::lock_guard<std::mutex> lock(request_mutex_);
+  if (!pending_) return;
+  RunRequest(*pending_->request, *pending_->response);
+  pending_->done = true;
+  pending_ = nullptr;
+  request_cond_.notify_all();
+}
+
+void GazeboSnapshotPlugin::RunRequest(const mmuav_msgs::PluginState::Request& request,
+                                      mmuav_msgs::PluginState::Response& response) {
+  boost::recursive_mutex::scoped_lock lock(*world_->Physics()->GetPhysicsUpdateMutex());
+  common::Time start = common::Time::GetWallTime();
+  std::string error;
+
+  if (request.operation == mmuav_msgs::PluginState::Request::SAVE) {
+    SnapshotRegistry::Instance().Save(&response.state);
+    if (!request.name.empty())
+      checkpoints_[request.name] = response.state;
+    response.success = true;
+  }
+  else if (request.operation == mmuav_msgs::PluginState::Request::RESTORE) {
+    const std::vector<uint8_t>* blob = &request.state;
+    if (blob->empty()) {
+      auto it = checkpoints_.find(request.name);
+      if (it == checkpoints_.end())
+        error = "no checkpoint named \"" + request.name + "\"";
+      else
+        blob = &it->second;
+    }
+    response.success = error.empty() && SnapshotRegistry::Instance().Restore(*blob, &error);
+  }
+  else
+    error = "unknown operation";
+
+  if (error.empty()) {
+    std::ostringstream message;
+    message << SnapshotRegistry::Instance().Clients() << " clients in "
+            << (common::Time::GetWallTime() - start).Double() * 1e3 << " ms";
+    response.message = message.str();
+  }
+  else {
+    response.success = false;
+    response.message = error;
+    gzerr << "[gazebo_snapshot_plugin] " << error << "\n";
+  }
+}
+
+GZ_REGISTER_WORLD_PLUGIN(GazeboSnapshotPlugin);
+}
@@ -0,0 +1,125 @@
+/*
+ * Hardware in the loop for the movable masses.
+ */
+
+#include "mmuav_plugins/gazebo_stepper_hil_plugin.h"
+
+#include <algorithm>
+#include <cmath>
+#include <boost/bind.hpp>
+
+namespace gazebo {
+
+GazeboStepperHilPlugin::GazeboStepperHilPlugin()
+    : steps_per_meter_(5066.0),
+      mass_limit_(0.07),
+      feedback_received_(false),
+      node_handle_(NULL) {
+  for (int i = 0; i < StepperProtocol::VALUES; i++)
+    measured_position_[i] = 0.0;
+}
+
+GazeboStepperHilPlugin::~GazeboStepperHilPlugin() {
+  updateConnection_.reset();
+  // No feedback callbacks after this point
+  transport_.Close();
+  if (node_handle_) {
+    node_handle_->shutdown();
+    delete node_handle_;
+  }
+}
+
+void GazeboStepperHilPlugin::Load(physics::ModelPtr _model,
+                                  sdf::ElementPtr _sdf) {
+  model_ = _model;
+
+  getSdfParam<std::string>(_sdf, "robotNamespace", namespace_, "");
+  getSdfParam<std::string>(_sdf, "commandSubTopic", command_sub_topic_,
+                           "movable_mass_all/command");
+  getSdfParam<std::string>(_sdf, "port", settings_.port, "/dev/ttyUSB0");
+  getSdfParam<int>(_sdf, "baudrate", settings_.baudrate, 115200);
+  getSdfParam<int>(_sdf, "protocol", settings_.protocol,
+                   int(StepperProtocol::LEGACY));
+  getSdfParam<double>(_sdf, "linkBudget", settings_.linkBudget, 0.8);
+  getSdfParam<double>(_sdf, "maxCommandRate", settings_.maxCommandRate, 0.0);
+  getSdfParam<double>(_sdf, "stepsPerMeter", steps_per_meter_, 5066.0);
+  getSdfParam<double>(_sdf, "massLimit", mass_limit_, 0.07);
+
+  // Joints in the order of the command and feedback values
+  std::string joint_prefix;
+  getSdfParam<std::string>(_sdf, "jointPrefix", joint_prefix,
+                           "stick_to_movable_mass_");
+  for (int i = 0; i < StepperProtocol::VALUES; i++) {
+    std::string joint_name = joint_prefix + std::to_string(i);
+    physics::JointPtr joint = model_->GetJoint(joint_name);
+    if (joint == NULL)
+      gzthrow("[gazebo_stepper_hil_plugin] Couldn't find specified joint \""
+              << joint_name << "\".");
+    joints_.push_back(joint);
+  }
+
+  transport_.SetFrameCallback(
+      boost::bind(&GazeboStepperHilPlugin::HandleFrame, this, _1, _2));
+  std::string error;
+  if (!transport_.Open(settings_, error)) {
+    gzerr << "[gazebo_stepper_hil_plugin] Serial port " << settings_.port
+          << ": " << error << ", hardware in the loop is disabled.\n";
+    return;
+  }
+  gzmsg << "[gazebo_stepper_hil_plugin] Stepper board on " << settings_.port
+        << ", " << settings_.baudrate << " baud, protocol "
+        << settings_.protocol << ".\n";
+
+  node_handle_ = new ros::NodeHandle(namespace_);
+  // Commands are handed to the transport right in the subscriber callback
+  command_sub_ = node_handle_->subscribe(
+      command_sub_topic_, 1, &GazeboStepperHilPlugin::CommandCallback, this,
+      ros::TransportHints().tcpNoDelay());
+
+  updateConnection_ = event::Events::ConnectWorldUpdateBegin(
+      boost::bind(&GazeboStepperHilPlugin::OnUpdate, this, _1));
+}
+
+void GazeboStepperHilPlugin::CommandCallback(
+    const std_msgs::Float64MultiArray &msg) {
+  if (msg.data.size() < StepperProtocol::VALUES) {
+    gzwarn << "[gazebo_stepper_hil_plugin] Not enough data. Length: "
+           << msg.data.size() << "\n";
+    return;
+  }
+
+  int32_t steps[StepperProtocol::VALUES];
+  for (int i = 0; i < StepperProtocol::VALUES; i++) {
+    double position =
+        std::max(-mass_limit_, std::min(mass_limit_, msg.data[i]));
+    steps[i] = int32_t(steps_per_meter_ * position);
+  }
+  transport_.SendCommand(steps);
+}
+
+void GazeboStepperHilPlugin::HandleFrame(const StepperLink::Frame &frame,
+                                         double /*received_time*/) {
+  if (frame.type != StepperProtocol::FEEDBACK) return;
+
+  boost::mutex::scoped_lock lock(feedback_mutex_);
+  for (int i = 0; i < StepperProtocol::VALUES; i++)
+    measured_position_[i] = double(frame.values[i]) / steps_per_meter_;
+  feedback_received_ = true;
+}
+
+void GazeboStepperHilPlugin::OnUpdate(const common::UpdateInfo & /*_info*/) {
+  double position[StepperProtocol::VALUES];
+  {
+    boost::mutex::scoped_lock lock(feedback_mutex_);
+    if (!feedback_received_) return;
+    std::copy(measured_position_, measured_position_ + StepperProtocol::VALUES,
+              position);
+  }
+
+  // Masses follow the measured positions kinematically
+  for (size_t i = 0; i < joints_.size(); i++)
+    joints_[i]->SetPosition(0, position[i]);
+}
+
+GZ_REGISTER_MODEL_PLUGIN(GazeboStepperHilPlugin);
+}
@@ -0,0 +1,94 @@
+/*
+ * Registry of parallel update clients and the worker pool driving them.
+ */
+
+#include "mmuav_plugins/parallel_update.h"
+
+#include <algorithm>
+
+namespace gazebo {
+
+ParallelUpdateRegistry& ParallelUpdateRegistry::Instance() {
+  static ParallelUpdateRegistry registry;
+  return registry;
+}
+
+void ParallelUpdateRegistry::Register(ParallelUpdateClient* client) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clients_.push_back(client);
+  version_++;
+}
+
+void ParallelUpdateRegistry::Unregister(ParallelUpdateClient* client) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
+  version_++;
+}
+
+void ParallelUpdateRegistry::GetClients(std::vector<ParallelUpdateClient*>& clients) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clients = clients_;
+}
+
+WorkerPool::WorkerPool(unsigned int threads)
+    : task_(nullptr), count_(0), next_(0), busy_(0), generation_(0), stop_(false) {
+  for (unsigned int i = 1; i < threads; i++)
+    workers_.push_back(std::thread(&WorkerPool::Work, this));
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++)
+    workers_[i].join();
+}
+
+void WorkerPool::Run(size_t count, const std::function<void(size_t)>& task) {
+  if (count == 0) return;
+  if (workers_.empty() || count == 1) {
+    for (size_t i = 0; i < count; i++) task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    next_ = 0;
+    busy_ = unsigned(workers_.size());
+    generation_++;
+  }
+  start_.notify_all();
+  RunTasks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return busy_ == 0; });
+  task_ = nullptr;
+}
+
+void WorkerPool::Work() {
+  unsigned long seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+    RunTasks();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) done_.notify_one();
+    }
+  }
+}
+
+void WorkerPool::RunTasks() {
+  for (size_t i = next_++; i < count_; i = next_++)
+    (*task_)(i);
+}
+
+}
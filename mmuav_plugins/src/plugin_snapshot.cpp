@@ -0,0 +1,117 @@
+/*
+ * Registry of plugins taking part in state snapshots.
+ */
+
+#include "mmuav_plugins/plugin_snapshot.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace gazebo {
+
+namespace {
+const uint32_t kSnapshotMagic = 0x5353554d;  // "MUSS"
+const uint32_t kSnapshotVersion = 1;
+}
+
+SnapshotRegistry& SnapshotRegistry::Instance() {
+  static SnapshotRegistry registry;
+  return registry;
+}
+
+void SnapshotRegistry::Register(SnapshotClient* client) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clients_.push_back(client);
+}
+
+void SnapshotRegistry::Unregister(SnapshotClient* client) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
+}
+
+size_t SnapshotRegistry::Clients() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return clients_.size();
+}
+
+void SnapshotRegistry::Save(std::vector<uint8_t>* blob) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  blob->clear();
+  StateWriter writer(blob);
+  writer.Write(kSnapshotMagic);
+  writer.Write(kSnapshotVersion);
+  writer.Write(uint32_t(clients_.size()));
+  for (size_t i = 0; i < clients_.size(); i++) {
+    writer.Write(clients_[i]->SnapshotId());
+    // Payload size is filled in once the client has written its state
+    size_t size_offset = writer.Size();
+    writer.Write(uint32_t(0));
+    clients_[i]->SaveState(writer);
+    uint32_t size = uint32_t(writer.Size() - size_offset - sizeof(uint32_t));
+    std::memcpy(&(*blob)[size_offset], &size, sizeof(size));
+  }
+}
+
+bool SnapshotRegistry::Restore(const std::vector<uint8_t>& blob, std::string* error) {
+  const uint8_t* begin = blob.data();
+  const uint8_t* end = begin + blob.size();
+  StateReader reader(begin, end);
+  uint32_t magic, version, count;
+  if (!reader.Read(&magic) || magic != kSnapshotMagic) {
+    *error = "not a plugin state snapshot";
+    return false;
+  }
+  if (!reader.Read(&version) || version != kSnapshotVersion) {
+    *error = "unsupported snapshot version";
+    return false;
+  }
+  if (!reader.Read(&count)) {
+    *error = "truncated snapshot";
+    return false;
+  }
+
+  // Index the payloads first, so a bad blob changes nothing
+  std::map<std::string, std::pair<const uint8_t*, const uint8_t*>> payloads;
+  for (uint32_t i = 0; i < count; i++) {
+    std::string id;
+    uint32_t size;
+    if (!reader.Read(&id) || !reader.Read(&size) || reader.Remaining() < size) {
+      *error = "truncated snapshot";
+      return false;
+    }
+    const uint8_t* payload = end - reader.Remaining();
+    payloads[id] = std::make_pair(payload, payload + size);
+    reader = StateReader(payload + size, end);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < clients_.size(); i++) {
+    if (!payloads.count(clients_[i]->SnapshotId())) {
+      *error = "snapshot has no state for " + clients_[i]->SnapshotId();
+      return false;
+    }
+  }
+  // Current state of every client, restored again if any client rejects
+  // its payload, so a failed restore leaves all plugins as they were
+  std::vector<std::vector<uint8_t>> backup(clients_.size());
+  for (size_t i = 0; i < clients_.size(); i++) {
+    StateWriter writer(&backup[i]);
+    clients_[i]->SaveState(writer);
+  }
+  for (size_t i = 0; i < clients_.size(); i++) {
+    std::string id = clients_[i]->SnapshotId();
+    StateReader payload(payloads[id].first, payloads[id].second);
+    if (!clients_[i]->RestoreState(payload) || payload.Remaining() != 0) {
+      *error = "state of " + id + " does not match the plugin, nothing restored";
+      for (size_t j = 0; j <= i; j++) {
+        StateReader previous(backup[j].data(), backup[j].data() + backup[j].size());
+        clients_[j]->RestoreState(previous);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+}
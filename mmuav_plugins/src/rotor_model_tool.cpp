@@ -0,0 +1,599 @@
+/*
+ * Offline evaluation and fitting of the ducted fan rotor model, using the
+ * equations of the motor model plugin (ductedfan_model.h) without Gazebo.
+ *
+ *   rotor_model_tool eval --samples in.csv [--output out.csv]
+ *   rotor_model_tool fit --samples bench.csv --fit name,name,... [--xacro out.xacro]
+ *
+ * Parameters start at the plugin defaults and are read from the
+ * <xacro:property name value> lines of --params files (e.g.
+ * dfcuav.base.urdf.xacro) and from --set name=value, in that order.
+ * --sweep name=first:last:count evaluates the grid of all sweeps.
+ *
+ * Sample files are CSV with a header. rotor_velocity [rad/s] is required,
+ * flap_angle, antitorque_flap_angle and airspeed_x/y/z (perpendicular to
+ * the rotor axis, rotor frame) default to 0. eval writes the samples with
+ * force_x/y/z and moment_x/y/z added (moments include the rolling moment,
+ * forces the air drag), and a set column when sweeping. fit uses whichever
+ * of these output columns the file has as measurements, so eval output can
+ * be fed back for a self check.
+ *
+ * Samples are split over --threads threads, every thread evaluates all
+ * parameter sets for its samples.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "mmuav_plugins/ductedfan_model.h"
+
+using gazebo::DuctedFanParameters;
+using gazebo::DuctedFanWrench;
+
+namespace {
+
+// -----------------------------------------------------------------------------
+// Parameters by name, the names are those of the xacro properties.
+// -----------------------------------------------------------------------------
+struct ParameterName {
+  const char* name;
+  double DuctedFanParameters::*member;
+};
+
+const ParameterName kParameterNames[] = {
+    {"max_rot_velocity", &DuctedFanParameters::max_rot_velocity},
+    {"moment_constant", &DuctedFanParameters::moment_constant},
+    {"motor_constant", &DuctedFanParameters::motor_constant},
+    {"rolling_moment_coefficient", &DuctedFanParameters::rolling_moment_coefficient},
+    {"rotor_drag_coefficient", &DuctedFanParameters::rotor_drag_coefficient},
+    {"rotor_velocity_slowdown_sim", &DuctedFanParameters::rotor_velocity_slowdown_sim},
+    {"time_constant_down", &DuctedFanParameters::time_constant_down},
+    {"time_constant_up", &DuctedFanParameters::time_constant_up},
+    {"fluid_density", &DuctedFanParameters::fluid_density},
+    {"area_control_flap", &DuctedFanParameters::area_control_flap},
+    {"area_antitorque_flap", &DuctedFanParameters::area_antitorque_flap},
+    {"distance_control_flap", &DuctedFanParameters::distance_control_flap},
+    {"distance_antitorque_flap", &DuctedFanParameters::distance_antitorque_flap},
+    {"thrust_coefficient", &DuctedFanParameters::thrust_coefficient},
+    {"torque_coefficient", &DuctedFanParameters::torque_coefficient},
+    {"slip_velocity_coefficient", &DuctedFanParameters::slip_velocity_coefficient},
+    {"lift_coefficient_control_flap", &DuctedFanParameters::lift_coefficient_control_flap},
+    {"drag_coefficient_control_flap", &DuctedFanParameters::drag_coefficient_control_flap},
+    {"lift_coefficient_antitorque_flap", &DuctedFanParameters::lift_coefficient_antitorque_flap},
+    {"drag_coefficient_antitorque_flap", &DuctedFanParameters::drag_coefficient_antitorque_flap},
+    {"lift_coefficient_control_flap_at0", &DuctedFanParameters::lift_coefficient_control_flap_at0},
+    {"drag_coefficient_control_flap_at0", &DuctedFanParameters::drag_coefficient_control_flap_at0},
+    {"lift_coefficient_antitorque_flap_at0",
+     &DuctedFanParameters::lift_coefficient_antitorque_flap_at0},
+    {"drag_coefficient_antitorque_flap_at0",
+     &DuctedFanParameters::drag_coefficient_antitorque_flap_at0},
+};
+
+double DuctedFanParameters::*FindParameter(const std::string& name) {
+  for (const ParameterName& parameter : kParameterNames)
+    if (name == parameter.name) return parameter.member;
+  return nullptr;
+}
+
+bool ParseDouble(const std::string& text, double* value) {
+  char* end;
+  *value = strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+bool SetParameter(DuctedFanParameters* params, const std::string& assignment) {
+  size_t equals = assignment.find('=');
+  double value;
+  double DuctedFanParameters::*member = FindParameter(assignment.substr(0, equals));
+  if (equals == std::string::npos || !member || !ParseDouble(assignment.substr(equals + 1), &value)) {
+    std::cerr << "Invalid parameter assignment " << assignment << "\n";
+    return false;
+  }
+  params->*member = value;
+  return true;
+}
+
+std::string XmlAttribute(const std::string& line, const std::string& name) {
+  std::string key = name + "=\"";
+  size_t start = line.find(key);
+  if (start == std::string::npos) return "";
+  start += key.size();
+  size_t end = line.find('"', start);
+  return end == std::string::npos ? "" : line.substr(start, end - start);
+}
+
+// Numeric xacro properties with a known name, others are skipped
+bool LoadXacroParameters(const std::string& path, DuctedFanParameters* params) {
+  std::ifstream file(path.c_str());
+  if (!file) {
+    std::cerr << "Cannot open " << path << "\n";
+    return false;
+  }
+  std::string line;
+  int loaded = 0;
+  while (std::getline(file, line)) {
+    if (line.find("xacro:property") == std::string::npos) continue;
+    std::string name = XmlAttribute(line, "name");
+    double value;
+    double DuctedFanParameters::*member = FindParameter(name);
+    if (!member || !ParseDouble(XmlAttribute(line, "value"), &value)) continue;
+    params->*member = value;
+    loaded++;
+  }
+  std::cerr << "Loaded " << loaded << " parameters from " << path << "\n";
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Samples, one array per column.
+// -----------------------------------------------------------------------------
+const char* const kInputColumns[] = {"rotor_velocity", "flap_angle", "antitorque_flap_angle",
+                                     "airspeed_x", "airspeed_y", "airspeed_z"};
+const char* const kOutputColumns[] = {"force_x", "force_y", "force_z",
+                                      "moment_x", "moment_y", "moment_z"};
+constexpr int kInputs = 6;
+constexpr int kOutputs = 6;
+
+struct Samples {
+  std::vector<std::string> header;
+  std::vector<std::vector<double>> columns;
+  int input[kInputs];    // column of each input, -1 - zero
+  int output[kOutputs];  // column of each measured output, -1 - not measured
+  size_t size = 0;
+
+  double Input(int i, size_t sample) const {
+    return input[i] < 0 ? 0.0 : columns[input[i]][sample];
+  }
+};
+
+bool LoadSamples(const std::string& path, Samples* samples) {
+  std::ifstream file(path.c_str());
+  if (!file) {
+    std::cerr << "Cannot open " << path << "\n";
+    return false;
+  }
+  std::string line;
+  if (!std::getline(file, line)) {
+    std::cerr << path << " is empty\n";
+    return false;
+  }
+  std::istringstream header(line);
+  std::string name;
+  while (std::getline(header, name, ',')) {
+    name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+    samples->header.push_back(name);
+  }
+  samples->columns.resize(samples->header.size());
+  for (int i = 0; i < kInputs; i++) {
+    auto it = std::find(samples->header.begin(), samples->header.end(), kInputColumns[i]);
+    samples->input[i] = it == samples->header.end() ? -1 : int(it - samples->header.begin());
+  }
+  for (int i = 0; i < kOutputs; i++) {
+    auto it = std::find(samples->header.begin(), samples->header.end(), kOutputColumns[i]);
+    samples->output[i] = it == samples->header.end() ? -1 : int(it - samples->header.begin());
+  }
+  if (samples->input[0] < 0) {
+    std::cerr << path << " has no rotor_velocity column\n";
+    return false;
+  }
+
+  for (int number = 2; std::getline(file, line); number++) {
+    if (line.empty()) continue;
+    const char* position = line.c_str();
+    for (size_t column = 0; column < samples->columns.size(); column++) {
+      char* end;
+      double value = strtod(position, &end);
+      if (end == position) {
+        std::cerr << path << ":" << number << ": invalid value in column "
+                  << samples->header[column] << "\n";
+        return false;
+      }
+      samples->columns[column].push_back(value);
+      position = end + (*end == ',' ? 1 : 0);
+    }
+    samples->size++;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Rotor configuration and the threaded evaluation.
+// -----------------------------------------------------------------------------
+struct Rotor {
+  double flap_x = 1.0;
+  double flap_y = 0.0;
+  int turning_direction = 1;
+};
+
+void ToOutputs(const DuctedFanWrench& wrench, double* outputs) {
+  for (int i = 0; i < 3; i++) {
+    outputs[i] = wrench.force[i] + wrench.air_drag[i];
+    outputs[3 + i] = wrench.moment[i] + wrench.rolling_moment[i];
+  }
+}
+
+// Calls task(thread, first, last) for equal sample ranges on threads threads
+template <class Task>
+void ParallelRanges(size_t count, int threads, const Task& task) {
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    size_t first = count * t / threads, last = count * (t + 1) / threads;
+    workers.push_back(std::thread([&task, t, first, last] { task(t, first, last); }));
+  }
+  for (std::thread& worker : workers) worker.join();
+}
+
+// Outputs of all parameter sets, outputs[set][sample * kOutputs + output]
+void Evaluate(const std::vector<DuctedFanParameters>& sets, const Rotor& rotor,
+              const Samples& samples, int threads, std::vector<std::vector<double>>* outputs) {
+  outputs->assign(sets.size(), std::vector<double>(samples.size * kOutputs));
+  ParallelRanges(samples.size, threads, [&](int, size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+      double airspeed[3] = {samples.Input(3, i), samples.Input(4, i), samples.Input(5, i)};
+      for (size_t s = 0; s < sets.size(); s++) {
+        DuctedFanWrench wrench = gazebo::EvaluateDuctedFan(
+            sets[s], samples.Input(0, i), samples.Input(1, i), samples.Input(2, i), rotor.flap_x,
+            rotor.flap_y, rotor.turning_direction, airspeed);
+        ToOutputs(wrench, &(*outputs)[s][i * kOutputs]);
+      }
+    }
+  });
+}
+
+// -----------------------------------------------------------------------------
+// Levenberg-Marquardt fit in parameters scaled by their start values, with
+// forward difference derivatives. J^T J and J^T r are accumulated per thread
+// so the Jacobian of millions of samples is never stored.
+// -----------------------------------------------------------------------------
+struct Fit {
+  std::vector<double DuctedFanParameters::*> members;
+  std::vector<std::string> names;
+  std::vector<double> scale;
+  std::vector<int> measured;      // output indices with measurements
+  std::vector<double> weight;     // 1 / standard deviation of each measurement
+};
+
+DuctedFanParameters Scaled(const DuctedFanParameters& base, const Fit& fit,
+                           const Eigen::VectorXd& x) {
+  DuctedFanParameters params = base;
+  for (size_t k = 0; k < fit.members.size(); k++) params.*fit.members[k] = x[k] * fit.scale[k];
+  return params;
+}
+
+// Weighted squared residual sum, with J^T J and J^T r if normal is given
+double Accumulate(const DuctedFanParameters& base, const Fit& fit, const Eigen::VectorXd& x,
+                  const Rotor& rotor, const Samples& samples, int threads,
+                  Eigen::MatrixXd* jtj, Eigen::VectorXd* jtr) {
+  const int n = int(x.size());
+  const double kStep = 1e-6;
+  std::vector<DuctedFanParameters> sets(1, Scaled(base, fit, x));
+  if (jtj) {
+    for (int k = 0; k < n; k++) {
+      Eigen::VectorXd perturbed = x;
+      perturbed[k] += kStep * std::max(1.0, std::abs(x[k]));
+      sets.push_back(Scaled(base, fit, perturbed));
+    }
+  }
+
+  std::vector<double> costs(threads, 0.0);
+  std::vector<Eigen::MatrixXd> jtjs(threads, Eigen::MatrixXd::Zero(n, n));
+  std::vector<Eigen::VectorXd> jtrs(threads, Eigen::VectorXd::Zero(n));
+  ParallelRanges(samples.size, threads, [&](int t, size_t first, size_t last) {
+    std::vector<double> outputs(sets.size() * kOutputs);
+    Eigen::VectorXd row(n);
+    for (size_t i = first; i < last; i++) {
+      double airspeed[3] = {samples.Input(3, i), samples.Input(4, i), samples.Input(5, i)};
+      for (size_t s = 0; s < sets.size(); s++) {
+        DuctedFanWrench wrench = gazebo::EvaluateDuctedFan(
+            sets[s], samples.Input(0, i), samples.Input(1, i), samples.Input(2, i), rotor.flap_x,
+            rotor.flap_y, rotor.turning_direction, airspeed);
+        ToOutputs(wrench, &outputs[s * kOutputs]);
+      }
+      for (size_t m = 0; m < fit.measured.size(); m++) {
+        int o = fit.measured[m];
+        double residual = fit.weight[m] * (outputs[o] - samples.columns[samples.output[o]][i]);
+        costs[t] += residual * residual;
+        if (!jtj) continue;
+        for (int k = 0; k < n; k++) {
+          double step = kStep * std::max(1.0, std::abs(x[k]));
+          row[k] = fit.weight[m] * (outputs[(k + 1) * kOutputs + o] - outputs[o]) / step;
+        }
+        jtjs[t].selfadjointView<Eigen::Lower>().rankUpdate(row);
+        jtrs[t] += row * residual;
+      }
+    }
+  });
+
+  double cost = 0.0;
+  if (jtj) {
+    jtj->setZero(n, n);
+    jtr->setZero(n);
+  }
+  for (int t = 0; t < threads; t++) {
+    cost += costs[t];
+    if (!jtj) continue;
+    *jtj += jtjs[t];
+    *jtr += jtrs[t];
+  }
+  if (jtj) *jtj = jtj->selfadjointView<Eigen::Lower>();
+  return cost;
+}
+
+void PrintResiduals(const char* label, const DuctedFanParameters& params, const Fit& fit,
+                    const Rotor& rotor, const Samples& samples, int threads) {
+  std::vector<std::vector<double>> outputs;
+  Evaluate(std::vector<DuctedFanParameters>(1, params), rotor, samples, threads, &outputs);
+  std::cerr << label << " RMS residuals:";
+  for (int o : fit.measured) {
+    double sum = 0.0;
+    for (size_t i = 0; i < samples.size; i++) {
+      double residual = outputs[0][i * kOutputs + o] - samples.columns[samples.output[o]][i];
+      sum += residual * residual;
+    }
+    std::cerr << " " << kOutputColumns[o] << " " << std::sqrt(sum / samples.size);
+  }
+  std::cerr << "\n";
+}
+
+bool RunFit(DuctedFanParameters* params, const Rotor& rotor, const Samples& samples,
+            const std::string& fit_names, int threads, int max_iterations) {
+  Fit fit;
+  std::istringstream names(fit_names);
+  std::string name;
+  while (std::getline(names, name, ',')) {
+    double DuctedFanParameters::*member = FindParameter(name);
+    if (!member) {
+      std::cerr << "Unknown parameter " << name << "\n";
+      return false;
+    }
+    fit.members.push_back(member);
+    fit.names.push_back(name);
+    fit.scale.push_back(params->*member != 0.0 ? params->*member : 1.0);
+  }
+  for (int o = 0; o < kOutputs; o++) {
+    if (samples.output[o] < 0) continue;
+    const std::vector<double>& column = samples.columns[samples.output[o]];
+    double mean = 0.0, square = 0.0;
+    for (double value : column) mean += value;
+    mean /= column.size();
+    for (double value : column) square += (value - mean) * (value - mean);
+    double deviation = std::sqrt(square / column.size());
+    fit.measured.push_back(o);
+    fit.weight.push_back(deviation > 0.0 ? 1.0 / deviation : 1.0);
+  }
+  if (fit.members.empty() || fit.measured.empty() || samples.size == 0) {
+    std::cerr << "Nothing to fit, give --fit and samples with measured output columns\n";
+    return false;
+  }
+
+  const int n = int(fit.members.size());
+  Eigen::VectorXd x = Eigen::VectorXd::Ones(n);
+  Eigen::MatrixXd jtj;
+  Eigen::VectorXd jtr;
+  double lambda = 1e-3;
+  double cost = Accumulate(*params, fit, x, rotor, samples, threads, &jtj, &jtr);
+  PrintResiduals("Initial", *params, fit, rotor, samples, threads);
+
+  for (int iteration = 0; iteration < max_iterations; iteration++) {
+    Eigen::MatrixXd damped = jtj;
+    for (int k = 0; k < n; k++) damped(k, k) += lambda * std::max(jtj(k, k), 1e-12);
+    Eigen::VectorXd step = damped.ldlt().solve(-jtr);
+    Eigen::VectorXd candidate = x + step;
+    double candidate_cost = Accumulate(*params, fit, candidate, rotor, samples, threads,
+                                       nullptr, nullptr);
+    if (candidate_cost < cost) {
+      bool converged = cost - candidate_cost < 1e-12 * cost || step.norm() < 1e-12 * x.norm();
+      x = candidate;
+      cost = Accumulate(*params, fit, x, rotor, samples, threads, &jtj, &jtr);
+      lambda = std::max(lambda / 10.0, 1e-12);
+      if (converged) break;
+    }
+    else {
+      lambda *= 10.0;
+      if (lambda > 1e12) break;
+    }
+  }
+  *params = Scaled(*params, fit, x);
+  PrintResiduals("Final", *params, fit, rotor, samples, threads);
+
+  // Standard errors and correlations from the weighted residual variance
+  Eigen::MatrixXd covariance = jtj.completeOrthogonalDecomposition().pseudoInverse();
+  double dof = std::max(1.0, double(samples.size * fit.measured.size()) - n);
+  covariance *= cost / dof;
+  for (int k = 0; k < n; k++) {
+    if (jtj(k, k) <= 0.0)
+      std::cerr << "Warning: " << fit.names[k] << " does not affect the measured outputs\n";
+    std::cerr << fit.names[k] << " = " << params->*fit.members[k] << " +- "
+              << std::sqrt(std::max(0.0, covariance(k, k))) * fit.scale[k] << "\n";
+  }
+  for (int k = 0; k < n; k++) {
+    for (int l = k + 1; l < n; l++) {
+      double correlation = covariance(k, l) / std::sqrt(covariance(k, k) * covariance(l, l));
+      if (std::abs(correlation) > 0.99)
+        std::cerr << "Warning: " << fit.names[k] << " and " << fit.names[l]
+                  << " are not separable from these samples (correlation " << correlation
+                  << "), fix one of them\n";
+    }
+  }
+  return true;
+}
+
+bool WriteXacro(const std::string& path, const DuctedFanParameters& params,
+                const std::string& fit_names, const std::string& samples_path, size_t samples) {
+  std::ofstream file(path.c_str());
+  if (!file) {
+    std::cerr << "Cannot write " << path << "\n";
+    return false;
+  }
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<!-- Fitted by rotor_model_tool to " << samples_path << " (" << samples
+       << " samples). -->\n"
+       << "<robot xmlns:xacro=\"http://www.ros.org/wiki/xacro\">\n";
+  std::istringstream names(fit_names);
+  std::string name;
+  char value[32];
+  while (std::getline(names, name, ',')) {
+    snprintf(value, sizeof(value), "%.9g", params.*FindParameter(name));
+    file << "  <xacro:property name=\"" << name << "\" value=\"" << value << "\" />\n";
+  }
+  file << "</robot>\n";
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Parameter sweeps, name=first:last:count.
+// -----------------------------------------------------------------------------
+struct Sweep {
+  double DuctedFanParameters::*member;
+  std::string name;
+  std::vector<double> values;
+};
+
+bool ParseSweep(const std::string& text, Sweep* sweep) {
+  size_t equals = text.find('=');
+  double first, last;
+  int count;
+  sweep->name = text.substr(0, equals);
+  sweep->member = FindParameter(sweep->name);
+  if (equals == std::string::npos || !sweep->member ||
+      sscanf(text.c_str() + equals + 1, "%lf:%lf:%d", &first, &last, &count) != 3 || count < 1) {
+    std::cerr << "Invalid sweep " << text << ", use name=first:last:count\n";
+    return false;
+  }
+  for (int i = 0; i < count; i++)
+    sweep->values.push_back(count == 1 ? first : first + (last - first) * i / (count - 1));
+  return true;
+}
+
+std::vector<DuctedFanParameters> SweepSets(const DuctedFanParameters& base,
+                                           const std::vector<Sweep>& sweeps) {
+  std::vector<DuctedFanParameters> sets(1, base);
+  for (const Sweep& sweep : sweeps) {
+    std::vector<DuctedFanParameters> grid;
+    for (const DuctedFanParameters& set : sets) {
+      for (double value : sweep.values) {
+        grid.push_back(set);
+        grid.back().*sweep.member = value;
+      }
+    }
+    sets.swap(grid);
+  }
+  return sets;
+}
+
+void Usage() {
+  std::cerr << "Usage: rotor_model_tool eval|fit --samples file.csv [options]\n"
+               "  --params file.xacro       read numeric xacro properties, repeatable\n"
+               "  --set name=value          set a parameter, repeatable\n"
+               "  --motor-number n          control flap along x (0, 2) or y (1, 3), default 0\n"
+               "  --turning-direction cw|ccw  default ccw\n"
+               "  --threads n               default one per core\n"
+               "eval:\n"
+               "  --sweep name=first:last:count  evaluate a grid of parameter sets, repeatable\n"
+               "  --output file.csv         default stdout\n"
+               "fit:\n"
+               "  --fit name,name,...       parameters to fit\n"
+               "  --iterations n            default 100\n"
+               "  --xacro file.xacro        write the fitted parameters as xacro properties\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || (strcmp(argv[1], "eval") && strcmp(argv[1], "fit"))) {
+    Usage();
+    return 2;
+  }
+  const bool fit_mode = !strcmp(argv[1], "fit");
+
+  DuctedFanParameters params;
+  Rotor rotor;
+  std::vector<Sweep> sweeps;
+  std::string samples_path, output_path, xacro_path, fit_names;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  int iterations = 100;
+  for (int i = 2; i < argc; i++) {
+    std::string option = argv[i];
+    if (i + 1 >= argc) {
+      Usage();
+      return 2;
+    }
+    std::string value = argv[++i];
+    if (option == "--samples") samples_path = value;
+    else if (option == "--params") {
+      if (!LoadXacroParameters(value, &params)) return 1;
+    }
+    else if (option == "--set") {
+      if (!SetParameter(&params, value)) return 2;
+    }
+    else if (option == "--sweep") {
+      sweeps.push_back(Sweep());
+      if (!ParseSweep(value, &sweeps.back())) return 2;
+    }
+    else if (option == "--motor-number") {
+      int motor_number = atoi(value.c_str());
+      rotor.flap_x = motor_number % 2 == 0 ? 1.0 : 0.0;
+      rotor.flap_y = 1.0 - rotor.flap_x;
+    }
+    else if (option == "--turning-direction") rotor.turning_direction = value == "cw" ? -1 : 1;
+    else if (option == "--threads") threads = std::max(1, atoi(value.c_str()));
+    else if (option == "--output") output_path = value;
+    else if (option == "--fit") fit_names = value;
+    else if (option == "--iterations") iterations = atoi(value.c_str());
+    else if (option == "--xacro") xacro_path = value;
+    else {
+      Usage();
+      return 2;
+    }
+  }
+
+  Samples samples;
+  if (samples_path.empty()) {
+    Usage();
+    return 2;
+  }
+  if (!LoadSamples(samples_path, &samples)) return 1;
+
+  if (fit_mode) {
+    if (!RunFit(&params, rotor, samples, fit_names, threads, iterations)) return 1;
+    if (!xacro_path.empty() &&
+        !WriteXacro(xacro_path, params, fit_names, samples_path, samples.size))
+      return 1;
+    return 0;
+  }
+
+  std::vector<DuctedFanParameters> sets = SweepSets(params, sweeps);
+  std::vector<std::vector<double>> outputs;
+  Evaluate(sets, rotor, samples, threads, &outputs);
+
+  std::ofstream file;
+  if (!output_path.empty()) file.open(output_path.c_str());
+  std::ostream& out = output_path.empty() ? std::cout : file;
+  out.precision(9);
+  if (!sweeps.empty()) out << "set,";
+  for (const Sweep& sweep : sweeps) out << sweep.name << ",";
+  for (int i = 0; i < kInputs; i++) out << kInputColumns[i] << ",";
+  for (int o = 0; o < kOutputs; o++) out << kOutputColumns[o] << (o + 1 < kOutputs ? "," : "\n");
+  for (size_t s = 0; s < sets.size(); s++) {
+    for (size_t i = 0; i < samples.size; i++) {
+      if (!sweeps.empty()) out << s << ",";
+      for (const Sweep& sweep : sweeps) out << sets[s].*sweep.member << ",";
+      for (int k = 0; k < kInputs; k++) out << samples.Input(k, i) << ",";
+      for (int o = 0; o < kOutputs; o++)
+        out << outputs[s][i * kOutputs + o] << (o + 1 < kOutputs ? "," : "\n");
+    }
+  }
+  return out ? 0 : 1;
+}